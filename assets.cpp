@@ -0,0 +1,116 @@
+/******************************************
+*
+* Asset jobs.
+*
+*******************************************/
+
+#include <cmath>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+
+#include "assets.h"
+
+struct AssetJob {
+    AssetTiming timing;
+    std::function<void()> load, upload;
+};
+
+static std::mutex mutex;
+static std::condition_variable jobQueued, jobLoaded;
+static std::deque<AssetJob> queued, loaded;  // Waiting for a worker, waiting for their upload
+static int pending = 0;                       // Queued but not uploaded yet
+static bool stopping = false;
+static std::vector<std::thread> workers;
+static std::vector<AssetTiming> timings;      // Only touched by the uploading thread
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void runWorker() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        jobQueued.wait(lock, [] { return stopping || !queued.empty(); });
+        if (stopping) return;
+        AssetJob job = std::move(queued.front());
+        queued.pop_front();
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        job.load();
+        job.timing.loadMilliseconds = millisecondsSince(start);
+        lock.lock();
+        loaded.push_back(std::move(job));
+        jobLoaded.notify_all();
+    }
+}
+static void startAssetWorkers() {
+    int count = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    for (int i = 0; i < count; i++) workers.emplace_back(runWorker);
+    static bool registered = false;
+    if (!registered) atexit(stopAssetWorkers); // Before static destructors, which would end joinable threads
+    registered = true;
+}
+
+void queueAsset(const std::string &name, std::function<void()> load, std::function<void()> upload) {
+    if (workers.empty()) startAssetWorkers();
+    AssetJob job;
+    job.timing.name = name;
+    job.load = std::move(load);
+    job.upload = std::move(upload);
+    std::lock_guard<std::mutex> lock(mutex);
+    queued.push_back(std::move(job));
+    pending++;
+    jobQueued.notify_one();
+}
+
+int pumpAssetUploads(double budgetMilliseconds) {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!loaded.empty()) {
+        AssetJob job = std::move(loaded.front());
+        loaded.pop_front();
+        lock.unlock();
+        auto uploadStart = std::chrono::steady_clock::now();
+        if (job.upload) job.upload();
+        job.timing.uploadMilliseconds = millisecondsSince(uploadStart);
+        timings.push_back(job.timing);
+        lock.lock();
+        pending--;
+        if (millisecondsSince(start) >= budgetMilliseconds) break;
+    }
+    return pending;
+}
+
+void finishAssets() {
+    while (pumpAssetUploads(INFINITY) > 0) {
+        std::unique_lock<std::mutex> lock(mutex);
+        jobLoaded.wait(lock, [] { return !loaded.empty(); });
+    }
+}
+
+void stopAssetWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobQueued.notify_all();
+    }
+    for (std::thread &worker : workers) worker.join();
+    workers.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = false;
+    pending -= queued.size();
+    queued.clear();
+}
+
+int assetWorkerCount() {
+    return (int)workers.size();
+}
+
+const std::vector<AssetTiming> &assetTimings() {
+    return timings;
+}
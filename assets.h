@@ -0,0 +1,42 @@
+/******************************************
+*
+* Asset jobs. Decoding and tessellation run on worker threads while the
+* GL thread keeps drawing; each finished asset's GL upload is queued and
+* run by the GL thread a few at a time, within a per-frame time budget,
+* so startup never blocks on the slowest asset. No GL/GLUT dependencies.
+*
+*******************************************/
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+// Queue an asset. load runs on a worker thread and must not touch GL; upload
+// (optional) then runs on the thread calling pumpAssetUploads(). Workers start
+// on first use, one per core beside the GL thread's (at least one).
+void queueAsset(const std::string &name, std::function<void()> load, std::function<void()> upload = nullptr);
+
+// Run uploads of loaded assets, oldest first, until budgetMilliseconds have
+// passed (at least one runs if any is ready). Returns the number of assets
+// not uploaded yet.
+int pumpAssetUploads(double budgetMilliseconds);
+
+// Wait for every queued asset and run all uploads
+void finishAssets();
+
+// Let the workers finish their current job and join them (also done at exit)
+void stopAssetWorkers();
+
+int assetWorkerCount();
+
+// Time each asset took, in the order their uploads ran
+struct AssetTiming {
+    std::string name;
+    double loadMilliseconds = 0, uploadMilliseconds = 0;
+};
+const std::vector<AssetTiming> &assetTimings();
+
+#endif
@@ -0,0 +1,228 @@
+/******************************************
+*
+* Uniform-grid spatial index over the track barriers.
+*
+*******************************************/
+
+#include <cmath>
+#include <algorithm>
+
+#include "barriergrid.h"
+#include "simulation.h"
+
+// Padding applied when binning, larger than the car radii used by
+// isInsideBox() and isInsideCircle() so no overlapping cell is missed
+static const float binMargin = 8.0f;
+
+// Inclusive cell range covered by [lo, hi] along one axis
+static void cellRange(float lo, float hi, float origin, float cellSize, int cells, int &first, int &last) {
+    first = std::max(0, (int)std::floor((lo - origin) / cellSize));
+    last = std::min(cells - 1, (int)std::floor((hi - origin) / cellSize));
+}
+// Check if the ring [innerRadius, outerRadius] around (cx, cz) reaches into a cell
+static bool ringTouchesCell(float cx, float cz, float innerRadius, float outerRadius,
+                            float x1, float z1, float x2, float z2) {
+    float nearX = std::max(x1, std::min(cx, x2)) - cx;
+    float nearZ = std::max(z1, std::min(cz, z2)) - cz;
+    float farX = std::max(std::fabs(x1 - cx), std::fabs(x2 - cx));
+    float farZ = std::max(std::fabs(z1 - cz), std::fabs(z2 - cz));
+    float nearest = std::sqrt(nearX * nearX + nearZ * nearZ);
+    float farthest = std::sqrt(farX * farX + farZ * farZ);
+    return nearest <= outerRadius && farthest >= innerRadius;
+}
+// Visit every (cell, barrier) pair once, counting or filling the compressed rows
+template <typename Visit>
+static void binBarriers(const BarrierGrid &grid, float boxes[][6], int numBoxes, float circles[][7], int numCircles, Visit visit) {
+    for (int i = 0; i < numBoxes; i++) {
+        int c1, c2, r1, r2;
+        cellRange(std::min(boxes[i][0], boxes[i][3]) - binMargin, std::max(boxes[i][0], boxes[i][3]) + binMargin,
+                  grid.minX, grid.cellSize, grid.cols, c1, c2);
+        cellRange(std::min(boxes[i][2], boxes[i][5]) - binMargin, std::max(boxes[i][2], boxes[i][5]) + binMargin,
+                  grid.minZ, grid.cellSize, grid.rows, r1, r2);
+        for (int r = r1; r <= r2; r++)
+            for (int c = c1; c <= c2; c++) visit(false, r * grid.cols + c, i);
+    }
+    for (int i = 0; i < numCircles; i++) {
+        float cx = circles[i][0], cz = circles[i][2];
+        float outerRadius = std::max(circles[i][3], circles[i][4]) + binMargin;
+        float innerRadius = std::min(circles[i][3], circles[i][4]) - binMargin;
+        int c1, c2, r1, r2;
+        cellRange(cx - outerRadius, cx + outerRadius, grid.minX, grid.cellSize, grid.cols, c1, c2);
+        cellRange(cz - outerRadius, cz + outerRadius, grid.minZ, grid.cellSize, grid.rows, r1, r2);
+        for (int r = r1; r <= r2; r++) {
+            for (int c = c1; c <= c2; c++) {
+                float x1 = grid.minX + c * grid.cellSize, z1 = grid.minZ + r * grid.cellSize;
+                if (ringTouchesCell(cx, cz, innerRadius, outerRadius, x1, z1, x1 + grid.cellSize, z1 + grid.cellSize)) {
+                    visit(true, r * grid.cols + c, i);
+                }
+            }
+        }
+    }
+}
+void buildBarrierGrid(BarrierGrid &grid, float boxes[][6], int numBoxes, float circles[][7], int numCircles,
+                      float cellSize, int maxCells) {
+    grid.boxes = boxes;
+
+    // Extent of every barrier including the binning margin
+    float minX = INFINITY, minZ = INFINITY, maxX = -INFINITY, maxZ = -INFINITY;
+    for (int i = 0; i < numBoxes; i++) {
+        minX = std::min(minX, std::min(boxes[i][0], boxes[i][3]));
+        maxX = std::max(maxX, std::max(boxes[i][0], boxes[i][3]));
+        minZ = std::min(minZ, std::min(boxes[i][2], boxes[i][5]));
+        maxZ = std::max(maxZ, std::max(boxes[i][2], boxes[i][5]));
+    }
+    for (int i = 0; i < numCircles; i++) {
+        float radius = std::max(circles[i][3], circles[i][4]);
+        minX = std::min(minX, circles[i][0] - radius);
+        maxX = std::max(maxX, circles[i][0] + radius);
+        minZ = std::min(minZ, circles[i][2] - radius);
+        maxZ = std::max(maxZ, circles[i][2] + radius);
+    }
+    if (numBoxes + numCircles == 0) minX = minZ = maxX = maxZ = 0;
+
+    grid.minX = minX - binMargin;
+    grid.minZ = minZ - binMargin;
+    grid.cellSize = cellSize;
+    for (;;) {
+        grid.cols = (int)std::floor((maxX + binMargin - grid.minX) / grid.cellSize) + 1;
+        grid.rows = (int)std::floor((maxZ + binMargin - grid.minZ) / grid.cellSize) + 1;
+        if ((long)grid.cols * grid.rows <= maxCells) break;
+        grid.cellSize *= 2;
+    }
+
+    // Count, prefix-sum, then fill the compressed rows
+    int cells = grid.cols * grid.rows;
+    grid.boxCellStart.assign(cells + 1, 0);
+    grid.circleCellStart.assign(cells + 1, 0);
+    binBarriers(grid, boxes, numBoxes, circles, numCircles, [&](bool circle, int cell, int) {
+        (circle ? grid.circleCellStart : grid.boxCellStart)[cell + 1]++;
+    });
+    for (int c = 0; c < cells; c++) {
+        grid.boxCellStart[c + 1] += grid.boxCellStart[c];
+        grid.circleCellStart[c + 1] += grid.circleCellStart[c];
+    }
+    grid.boxItems.resize(grid.boxCellStart[cells]);
+    grid.circleItems.resize(grid.circleCellStart[cells]);
+    std::vector<int> boxFill(grid.boxCellStart.begin(), grid.boxCellStart.end() - 1);
+    std::vector<int> circleFill(grid.circleCellStart.begin(), grid.circleCellStart.end() - 1);
+    binBarriers(grid, boxes, numBoxes, circles, numCircles, [&](bool circle, int cell, int i) {
+        if (circle) grid.circleItems[circleFill[cell]++] = i;
+        else grid.boxItems[boxFill[cell]++] = i;
+    });
+    buildSectorTable(grid.sectors, circles, (int)grid.circleItems.size(), grid.circleItems.data());
+}
+bool gridCollides(const BarrierGrid &grid, float x, float z) {
+    float col = std::floor((x - grid.minX) / grid.cellSize);
+    float row = std::floor((z - grid.minZ) / grid.cellSize);
+    if (!(col >= 0 && row >= 0 && col < grid.cols && row < grid.rows)) return false; // No barriers outside the grid
+
+    int cell = (int)row * grid.cols + (int)col;
+    for (int i = grid.boxCellStart[cell]; i < grid.boxCellStart[cell + 1]; i++) {
+        if (isInsideBox(x, z, grid.boxes[grid.boxItems[i]])) return true;
+    }
+    return anySectorHit(grid.sectors, grid.circleCellStart[cell], grid.circleCellStart[cell + 1], x, z);
+}
+
+/*\ ---- Swept queries ---- \*/
+
+// Append the fraction t in (0, 1) at which the move (x0, z0) + t * (moveX, moveZ)
+// crosses the line a * x + b * z + c = 0, if it does
+static void addLineCrossing(std::vector<float> &crossings, float a, float b, float c,
+                            float x0, float z0, float moveX, float moveZ) {
+    float rate = a * moveX + b * moveZ;
+    if (rate == 0) return;
+    float t = -(a * x0 + b * z0 + c) / rate;
+    if (t > 0 && t < 1) crossings.push_back(t);
+}
+// Same for the circle of the given squared radius around (cx, cz)
+static void addCircleCrossings(std::vector<float> &crossings, float cx, float cz, float radiusSquared,
+                               float x0, float z0, float moveX, float moveZ) {
+    float dx = x0 - cx, dz = z0 - cz;
+    float a = moveX * moveX + moveZ * moveZ;
+    float b = 2 * (dx * moveX + dz * moveZ);
+    float c = dx * dx + dz * dz - radiusSquared;
+    float discriminant = b * b - 4 * a * c;
+    if (discriminant < 0) return;
+    float root = std::sqrt(discriminant);
+    for (float t : {(-b - root) / (2 * a), (-b + root) / (2 * a)}) {
+        if (t > 0 && t < 1) crossings.push_back(t);
+    }
+}
+// Boundary lines of one angular threshold of a sector (see SectorThresholds)
+static void addThresholdCrossings(std::vector<float> &crossings, const SectorThresholds &threshold, int i,
+                                  float cx, float cz, float x0, float z0, float moveX, float moveZ) {
+    addLineCrossing(crossings, -threshold.upperZ[i], threshold.upperX[i],
+                    threshold.upperBias[i] + threshold.upperZ[i] * cx - threshold.upperX[i] * cz, x0, z0, moveX, moveZ);
+    addLineCrossing(crossings, -threshold.lowerZ[i], threshold.lowerX[i],
+                    threshold.lowerBias[i] + threshold.lowerZ[i] * cx - threshold.lowerX[i] * cz, x0, z0, moveX, moveZ);
+    addLineCrossing(crossings, threshold.facingX[i], threshold.facingZ[i],
+                    -(threshold.facingX[i] * cx + threshold.facingZ[i] * cz), x0, z0, moveX, moveZ);
+}
+bool gridSweep(const BarrierGrid &grid, float x0, float z0, float x1, float z1, float *hitT) {
+    float boxRadius = 5.0f; // As in isInsideBox()
+    float moveX = x1 - x0, moveZ = z1 - z0;
+
+    // Whether a point is inside a barrier can only change where the path crosses
+    // one of the barrier's boundary lines or circles. Collect those crossings for
+    // every barrier in the cells the move spans; between two consecutive crossings
+    // one test point decides the whole stretch.
+    static thread_local std::vector<float> crossings;
+    crossings.clear();
+    crossings.push_back(0);
+    crossings.push_back(1);
+
+    if (moveX != 0 || moveZ != 0) {
+        float loX = std::min(x0, x1), hiX = std::max(x0, x1);
+        float loZ = std::min(z0, z1), hiZ = std::max(z0, z1);
+        int c1, c2, r1, r2;
+        cellRange(loX, hiX, grid.minX, grid.cellSize, grid.cols, c1, c2);
+        cellRange(loZ, hiZ, grid.minZ, grid.cellSize, grid.rows, r1, r2);
+        for (int r = r1; r <= r2; r++) {
+            for (int c = c1; c <= c2; c++) {
+                int cell = r * grid.cols + c;
+                for (int k = grid.boxCellStart[cell]; k < grid.boxCellStart[cell + 1]; k++) {
+                    const float *box = grid.boxes[grid.boxItems[k]];
+                    float bx1 = std::min(box[0], box[3]) - boxRadius, bx2 = std::max(box[0], box[3]) + boxRadius;
+                    float bz1 = std::min(box[2], box[5]) - boxRadius, bz2 = std::max(box[2], box[5]) + boxRadius;
+                    if (bx1 > hiX || bx2 < loX || bz1 > hiZ || bz2 < loZ) continue; // Out of the move's reach
+                    addLineCrossing(crossings, 1, 0, -bx1, x0, z0, moveX, moveZ);
+                    addLineCrossing(crossings, 1, 0, -bx2, x0, z0, moveX, moveZ);
+                    addLineCrossing(crossings, 0, 1, -bz1, x0, z0, moveX, moveZ);
+                    addLineCrossing(crossings, 0, 1, -bz2, x0, z0, moveX, moveZ);
+                }
+                const SectorTable &sectors = grid.sectors;
+                for (int i = grid.circleCellStart[cell]; i < grid.circleCellStart[cell + 1]; i++) {
+                    float cx = sectors.cx[i], cz = sectors.cz[i];
+                    float nearX = std::max(loX, std::min(cx, hiX)) - cx, nearZ = std::max(loZ, std::min(cz, hiZ)) - cz;
+                    if (nearX * nearX + nearZ * nearZ > sectors.outerSquared[i]) continue; // Out of the move's reach
+                    addCircleCrossings(crossings, cx, cz, sectors.outerSquared[i], x0, z0, moveX, moveZ);
+                    addCircleCrossings(crossings, cx, cz, sectors.innerSquared[i], x0, z0, moveX, moveZ);
+                    addLineCrossing(crossings, 0, 1, -cz, x0, z0, moveX, moveZ); // Upper/lower half switch
+                    addThresholdCrossings(crossings, sectors.start, i, cx, cz, x0, z0, moveX, moveZ);
+                    addThresholdCrossings(crossings, sectors.end, i, cx, cz, x0, z0, moveX, moveZ);
+                }
+            }
+        }
+        std::sort(crossings.begin(), crossings.end());
+        crossings.erase(std::unique(crossings.begin(), crossings.end()), crossings.end());
+    }
+
+    for (size_t k = 0; k + 1 < crossings.size(); k++) {
+        float t = crossings[k];
+        if (gridCollides(grid, x0 + t * moveX, z0 + t * moveZ)) {
+            *hitT = t;
+            return true;
+        }
+        float mid = 0.5f * (t + crossings[k + 1]);
+        if (gridCollides(grid, x0 + mid * moveX, z0 + mid * moveZ)) {
+            *hitT = t;
+            return true;
+        }
+    }
+    // The end of the move, at exactly the point a point query would test
+    if (gridCollides(grid, x1, z1)) {
+        *hitT = 1;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,49 @@
+/******************************************
+*
+* Uniform-grid spatial index over the track barriers. Built once from the
+* barrier arrays; each collision query then only tests the barriers that
+* overlap the car's grid cell, so lookup cost stays flat as the barrier
+* count grows.
+*
+*******************************************/
+
+#ifndef BARRIERGRID_H
+#define BARRIERGRID_H
+
+#include <vector>
+
+#include "sector.h"
+
+struct BarrierGrid {
+    float minX = 0, minZ = 0;  // World position of the first cell's corner
+    float cellSize = 0;
+    int cols = 0, rows = 0;
+
+    // Barrier indices per cell in compressed rows: cell c holds
+    // items[cellStart[c]] .. items[cellStart[c + 1] - 1]
+    std::vector<int> boxCellStart, boxItems;
+    std::vector<int> circleCellStart, circleItems;
+
+    float (*boxes)[6] = nullptr;
+    SectorTable sectors;  // Curved barriers laid out in circleItems order, one copy per cell
+
+    size_t bytes() const {
+        return (boxCellStart.size() + boxItems.size() + circleCellStart.size() + circleItems.size()) * sizeof(int) +
+               sectors.bytes();
+    }
+};
+
+// Bin the barriers into cells of cellSize units. The cell size grows if the
+// track is so large that the grid would exceed maxCells.
+void buildBarrierGrid(BarrierGrid &grid, float boxes[][6], int numBoxes, float circles[][7], int numCircles,
+                      float cellSize = 20.0f, int maxCells = 1 << 22);
+
+// Same result as isInsideAnyBox() || isInsideAnyCircle() over the indexed barriers
+bool gridCollides(const BarrierGrid &grid, float x, float z);
+
+// Sweep a car from (x0, z0) to (x1, z1) and find the first point on the path
+// where gridCollides() holds. Returns false if the whole path is clear,
+// otherwise true with the fraction of the move travelled in *hitT.
+bool gridSweep(const BarrierGrid &grid, float x0, float z0, float x1, float z1, float *hitT);
+
+#endif
@@ -0,0 +1,191 @@
+/******************************************
+*
+* Batch simulator kernels. The per-lane rules mirror stepSimulation()
+* operation for operation, so each lane tracks the scalar path exactly.
+*
+*******************************************/
+
+#include <cmath>
+#include <algorithm>
+
+#include "batch.h"
+#include "simd.h"
+#include "track.h"
+
+int batchSimdWidth() {
+    return SIMD_WIDTH;
+}
+void initBatch(BatchSim &batch, int count) {
+    int capacity = (count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    batch.count = count;
+    batch.capacity = capacity;
+    batch.meX.assign(capacity, 0);
+    batch.meZ.assign(capacity, 0);
+    batch.angleX.assign(capacity, 0);
+    batch.velocity.assign(capacity, 0);
+    batch.wheelAngle.assign(capacity, 0);
+    batch.inputs.assign(capacity, 0);
+    batch.lapStarted.assign(capacity, 0);
+    batch.currentCheckpoint.assign(capacity, 0);
+    batch.lapStartTime.assign(capacity, 0);
+    batch.lapEndTime.assign(capacity, 0);
+    batch.dirX.assign(capacity, 0);
+    batch.dirZ.assign(capacity, 0);
+    batch.proposedX.assign(capacity, 0);
+    batch.proposedZ.assign(capacity, 0);
+    batch.hit.assign(capacity, 0);
+    batch.time = 0;
+    for (int i = 0; i < capacity; i++) resetBatchCar(batch, i);
+}
+void resetBatchCar(BatchSim &batch, int i) {
+    SimState start;
+    resetSimulation(start);
+    batch.meX[i] = start.meX;
+    batch.meZ[i] = start.meZ;
+    batch.angleX[i] = start.angleX;
+    batch.velocity[i] = start.velocity;
+    batch.wheelAngle[i] = start.wheelAngle;
+    batch.lapStarted[i] = 0;
+    batch.currentCheckpoint[i] = 0;
+    batch.lapStartTime[i] = 0;
+    batch.lapEndTime[i] = 0;
+}
+
+// Velocity, steering and wheel angle for every lane (the first half of stepSimulation)
+static void stepControls(BatchSim &batch, float ticks) {
+    const SimParams &p = batch.params;
+    const vf zero = vset(0), one = vset(1), minusOne = vset(-1);
+    const vf accelStep = vset(p.acceleration * ticks);
+    const vf decelStep = vset(p.deceleration * ticks);
+    const vf maxVelocity = vset(p.maxVelocity), minVelocity = vset(-p.maxVelocity);
+    const vf slowTurn = vset(p.turnSpeed * 0.5f);
+    const vf turnSpeed = vset(p.turnSpeed), half = vset(0.5f);
+    const vf two = vset(2), tickScale = vset(ticks);
+    const vf wheelStep = vset(p.wheelAngleStep * ticks);
+    const vf maxWheel = vset(p.maxWheelAngle), minWheel = vset(-p.maxWheelAngle);
+
+    for (int i = 0; i < batch.capacity; i += SIMD_WIDTH) {
+        vf v = vload(&batch.velocity[i]);
+        vf a = vload(&batch.angleX[i]);
+        vf w = vload(&batch.wheelAngle[i]);
+        const int32_t *in = &batch.inputs[i];
+        vm accelerate = mbits(in, SIM_INPUT_ACCELERATE);
+        vm brake = mandnot(mand(mbits(in, SIM_INPUT_BRAKE), mload(&batch.lapStarted[i])), accelerate);
+        vm left = mbits(in, SIM_INPUT_STEER_LEFT);
+        vm right = mandnot(mbits(in, SIM_INPUT_STEER_RIGHT), left);
+
+        // Accelerate, decelerate, or coast towards zero
+        vf accelerated = vmin(vadd(v, accelStep), maxVelocity);
+        vf braked = vmax(vsub(v, decelStep), minVelocity);
+        vf coasted = vsel(vgt(v, zero), vsub(v, decelStep), vsel(vlt(v, zero), vadd(v, decelStep), v));
+        coasted = vsel(vlt(vabs(coasted), decelStep), zero, coasted);
+        v = vsel(accelerate, accelerated, vsel(brake, braked, coasted));
+
+        // Turning while moving
+        vm moving = mand(vne(v, zero), mload(&batch.lapStarted[i]));
+        vf sign = vsel(vgt(v, zero), one, minusOne);
+        vf speed = vabs(v);
+        vf fastTurn = vmul(turnSpeed, vsub(one, vmul(half, vdiv(speed, maxVelocity))));
+        vf turnAdjustment = vmul(vsel(vle(speed, two), slowTurn, fastTurn), sign);
+        turnAdjustment = vmul(turnAdjustment, tickScale);
+        vm turnLeft = mand(moving, left);
+        vm turnRight = mand(moving, right);
+        a = vadd(a, vsel(turnLeft, turnAdjustment, zero));
+        a = vsub(a, vsel(turnRight, turnAdjustment, zero));
+
+        // Wheel angle follows the steering, or recentres when the car is not moving
+        vf wheelLeft = vmin(vadd(w, vsel(vlt(w, maxWheel), wheelStep, zero)), maxWheel);
+        vf wheelRight = vmax(vsub(w, vsel(vgt(w, minWheel), wheelStep, zero)), minWheel);
+        vf wheelCentred = vsel(vlt(w, zero), vmin(vadd(w, wheelStep), zero),
+                          vsel(vgt(w, zero), vmax(vsub(w, wheelStep), zero), w));
+        w = vsel(turnLeft, wheelLeft, vsel(turnRight, wheelRight, vsel(moving, w, wheelCentred)));
+
+        vstore(&batch.velocity[i], v);
+        vstore(&batch.angleX[i], a);
+        vstore(&batch.wheelAngle[i], w);
+    }
+}
+// Proposed positions and barrier tests for every lane
+static void proposeMoves(BatchSim &batch, float ticks) {
+    // Heading vectors; the trig stays scalar so it matches stepSimulation()
+    for (int i = 0; i < batch.capacity; i++) {
+        batch.dirX[i] = sin(batch.angleX[i] * PI / 180);
+        batch.dirZ[i] = cos(batch.angleX[i] * PI / 180);
+    }
+
+    if (batch.params.distanceFieldCollision) {
+        // Field lookups resolve the contact in place; mark no lanes for resolveMoves()
+        for (int i = 0; i < batch.capacity; i++) {
+            moveWithDistanceField(batch.meX[i], batch.meZ[i], batch.velocity[i], batch.dirX[i], batch.dirZ[i],
+                                  batch.velocity[i] * ticks, batch.params);
+            batch.proposedX[i] = batch.meX[i];
+            batch.proposedZ[i] = batch.meZ[i];
+            batch.hit[i] = 0;
+        }
+        return;
+    }
+    if (batch.params.sweptCollision) {
+        // Swept moves also resolve the contact in place
+        for (int i = 0; i < batch.capacity; i++) {
+            moveSwept(batch.meX[i], batch.meZ[i], batch.velocity[i], batch.dirX[i], batch.dirZ[i],
+                      batch.velocity[i] * ticks, batch.params);
+            batch.proposedX[i] = batch.meX[i];
+            batch.proposedZ[i] = batch.meZ[i];
+            batch.hit[i] = 0;
+        }
+        return;
+    }
+
+    const vf tickScale = vset(ticks);
+    for (int i = 0; i < batch.capacity; i += SIMD_WIDTH) {
+        vf distance = vmul(vload(&batch.velocity[i]), tickScale);
+        vstore(&batch.proposedX[i], vadd(vload(&batch.meX[i]), vmul(distance, vload(&batch.dirX[i]))));
+        vstore(&batch.proposedZ[i], vadd(vload(&batch.meZ[i]), vmul(distance, vload(&batch.dirZ[i]))));
+    }
+
+    // Barrier lookups go through the track's spatial index
+    for (int i = 0; i < batch.capacity; i++) {
+        batch.hit[i] = collidesWithTrack(batch.proposedX[i], batch.proposedZ[i]) ? -1 : 0;
+    }
+}
+// Accept the move, or bounce back off the barrier
+static void resolveMoves(BatchSim &batch, float ticks) {
+    const vf tickScale = vset(ticks);
+    const vf bounce = vset(-batch.params.elasticity);
+    for (int i = 0; i < batch.capacity; i += SIMD_WIDTH) {
+        vm hit = mload(&batch.hit[i]);
+        vf v = vload(&batch.velocity[i]);
+        vf bounced = vmul(v, bounce);
+        vf distance = vmul(bounced, tickScale);
+        vf x = vload(&batch.meX[i]), z = vload(&batch.meZ[i]);
+        vf bouncedX = vadd(x, vmul(distance, vload(&batch.dirX[i])));
+        vf bouncedZ = vadd(z, vmul(distance, vload(&batch.dirZ[i])));
+        vstore(&batch.velocity[i], vsel(hit, bounced, v));
+        vstore(&batch.meX[i], vsel(hit, bouncedX, vload(&batch.proposedX[i])));
+        vstore(&batch.meZ[i], vsel(hit, bouncedZ, vload(&batch.proposedZ[i])));
+    }
+}
+int stepBatch(BatchSim &batch, float dt) {
+    float ticks = dt / SIM_TICK_SECONDS; // Tuning constants are per reference tick
+    batch.time += dt;
+
+    stepControls(batch, ticks);
+    proposeMoves(batch, ticks);
+    resolveMoves(batch, ticks);
+
+    // Checkpoints are sparse state-machine updates, so they stay scalar
+    int lapsCompleted = 0;
+    for (int i = 0; i < batch.count; i++) {
+        int checkpoint = batch.currentCheckpoint[i];
+        if (!isCheckpointReached(checkpoint, batch.meX[i], batch.meZ[i])) continue;
+        batch.currentCheckpoint[i] = ++checkpoint;
+        if (checkpoint == 1) {
+            batch.lapStartTime[i] = batch.time;
+            batch.lapStarted[i] = -1;
+        } else if (checkpoint == checkpointsCount) {
+            batch.lapEndTime[i] = batch.time;
+            lapsCompleted++;
+        }
+    }
+    return lapsCompleted;
+}
@@ -0,0 +1,48 @@
+/******************************************
+*
+* Batch simulator: N cars held in structure-of-arrays form and advanced
+* together each tick with SIMD kernels (AVX2, SSE2 or a scalar fallback).
+* Follows the same rules as stepSimulation() in simulation.cpp.
+*
+*******************************************/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <vector>
+#include <cstdint>
+
+#include "simulation.h"
+
+struct BatchSim {
+    int count = 0;     // Number of cars
+    int capacity = 0;  // count rounded up to the SIMD width; padding lanes are simulated but ignored
+
+    // Per-car state, one entry per lane
+    std::vector<float> meX, meZ, angleX, velocity, wheelAngle;
+    std::vector<int32_t> inputs;            // SIM_INPUT_* flags, set by the caller before each step
+    std::vector<int32_t> lapStarted;        // -1 once the lap timer has started, 0 before
+    std::vector<int32_t> currentCheckpoint;
+    std::vector<double> lapStartTime, lapEndTime;
+
+    // Scratch space reused between ticks
+    std::vector<float> dirX, dirZ, proposedX, proposedZ;
+    std::vector<int32_t> hit;
+
+    double time = 0;
+    SimParams params;  // Shared by every car in the batch
+};
+
+// Allocate a batch of count cars, all at the start line
+void initBatch(BatchSim &batch, int count);
+
+// Reposition car i at the start line and clear its lap timing
+void resetBatchCar(BatchSim &batch, int i);
+
+// Advance every car by dt seconds. Returns the number of laps completed this step.
+int stepBatch(BatchSim &batch, float dt = SIM_TICK_SECONDS);
+
+// Lanes processed per SIMD instruction in this build
+int batchSimdWidth();
+
+#endif
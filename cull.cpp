@@ -0,0 +1,76 @@
+/******************************************
+*
+* View-frustum culling.
+*
+*******************************************/
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __APPLE__
+#  include <GLUT/glut.h>
+#else
+#  include <GL/glut.h>
+#endif
+
+#include "cull.h"
+
+bool frustumCulling = true;
+CullCounters cullCounters;
+
+static float planes[6][4];  // a x + b y + c z + d >= 0 inside, with (a, b, c) of unit length
+
+void beginCullFrame() {
+    float modelview[16], projection[16], clip[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+
+    // clip = projection * modelview, column-major
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 4; ++row) {
+            float sum = 0;
+            for (int k = 0; k < 4; ++k) sum += projection[k * 4 + row] * modelview[col * 4 + k];
+            clip[col * 4 + row] = sum;
+        }
+    }
+
+    // Left, right, bottom, top, near, far: row 3 plus or minus rows 0, 1 and 2
+    for (int p = 0; p < 6; ++p) {
+        int row = p / 2;
+        float sign = (p % 2) ? -1.0f : 1.0f;
+        for (int col = 0; col < 4; ++col) planes[p][col] = clip[col * 4 + 3] + sign * clip[col * 4 + row];
+        float length = sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+        for (int col = 0; col < 4; ++col) planes[p][col] /= length;
+    }
+    memset(&cullCounters, 0, sizeof(cullCounters));
+}
+
+// Count the result of one test
+static bool record(bool inside) {
+    if (!frustumCulling) inside = true;
+    if (inside) cullCounters.visible++;
+    else cullCounters.culled++;
+    return inside;
+}
+bool sphereVisible(float x, float y, float z, float radius) {
+    for (int p = 0; p < 6; ++p) {
+        if (planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] < -radius) return record(false);
+    }
+    return record(true);
+}
+bool boxVisible(const float min[3], const float max[3]) {
+    for (int p = 0; p < 6; ++p) {
+        // The corner furthest along the plane normal
+        float x = planes[p][0] >= 0 ? max[0] : min[0];
+        float y = planes[p][1] >= 0 ? max[1] : min[1];
+        float z = planes[p][2] >= 0 ? max[2] : min[2];
+        if (planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] < 0) return record(false);
+    }
+    return record(true);
+}
+bool boxVisible(float x1, float y1, float z1, float x2, float y2, float z2) {
+    float min[3] = {std::min(x1, x2), std::min(y1, y2), std::min(z1, z2)};
+    float max[3] = {std::max(x1, x2), std::max(y1, y2), std::max(z1, z2)};
+    return boxVisible(min, max);
+}
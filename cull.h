@@ -0,0 +1,31 @@
+/******************************************
+*
+* View-frustum culling. The six clip planes are taken from the camera
+* each frame; objects whose bounding sphere or box lies entirely outside
+* any of them are skipped before any of their draw calls are issued.
+*
+*******************************************/
+
+#ifndef CULL_H
+#define CULL_H
+
+// When false every test passes, but objects are still counted
+extern bool frustumCulling;
+
+// Per-frame counters, reset by beginCullFrame()
+struct CullCounters {
+    long visible;  // Objects that passed the test and were drawn
+    long culled;   // Objects skipped because they are outside the view
+};
+extern CullCounters cullCounters;
+
+// Capture the camera (projection times the modelview right after gluLookAt)
+// and reset the counters. Call once per frame before drawing.
+void beginCullFrame();
+
+// Test and count one world-space bounding volume
+bool sphereVisible(float x, float y, float z, float radius);
+bool boxVisible(const float min[3], const float max[3]);
+bool boxVisible(float x1, float y1, float z1, float x2, float y2, float z2);
+
+#endif
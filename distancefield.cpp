@@ -0,0 +1,162 @@
+/******************************************
+*
+* Signed-distance field of the track barriers.
+*
+*******************************************/
+
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+
+#include "distancefield.h"
+#include "track.h"
+
+// Signed distance from (x, z) to the footprint of an along-axis barrier box
+static float boxDistance(float x, float z, const float box[6]) {
+    float cx = (box[0] + box[3]) * 0.5f, cz = (box[2] + box[5]) * 0.5f;
+    float hx = std::fabs(box[3] - box[0]) * 0.5f, hz = std::fabs(box[5] - box[2]) * 0.5f;
+    float qx = std::fabs(x - cx) - hx, qz = std::fabs(z - cz) - hz;
+    float outside = std::sqrt(std::max(qx, 0.0f) * std::max(qx, 0.0f) + std::max(qz, 0.0f) * std::max(qz, 0.0f));
+    return outside + std::min(std::max(qx, qz), 0.0f);
+}
+// Distance from (x, z) to the segment a-b
+static float segmentDistance(float x, float z, float ax, float az, float bx, float bz) {
+    float dx = bx - ax, dz = bz - az;
+    float t = ((x - ax) * dx + (z - az) * dz) / (dx * dx + dz * dz);
+    t = std::max(0.0f, std::min(1.0f, t));
+    float ex = x - (ax + t * dx), ez = z - (az + t * dz);
+    return std::sqrt(ex * ex + ez * ez);
+}
+// Signed distance from (x, z) to a curved barrier (annular sector)
+static float circleDistance(float x, float z, const float circle[7]) {
+    float cx = circle[0], cz = circle[2];
+    float outerRadius = std::max(circle[3], circle[4]);
+    float innerRadius = std::min(circle[3], circle[4]);
+    float startAngle = circle[5], endAngle = circle[6];
+    float dx = x - cx, dz = z - cz;
+    float r = std::sqrt(dx * dx + dz * dz);
+
+    // Inside the angular span the nearest point lies on one of the arcs
+    float span = endAngle - startAngle;
+    float angle = std::atan2(dz, dx) - startAngle;
+    angle -= std::floor(angle / (2 * PI)) * (2 * PI);
+    if (span >= 2 * PI || angle <= span) {
+        float mid = (outerRadius + innerRadius) * 0.5f, halfWidth = (outerRadius - innerRadius) * 0.5f;
+        return std::fabs(r - mid) - halfWidth;
+    }
+    // Otherwise on one of the two end caps
+    float s0 = std::sin(startAngle), c0 = std::cos(startAngle);
+    float s1 = std::sin(endAngle), c1 = std::cos(endAngle);
+    return std::min(segmentDistance(dx, dz, innerRadius * c0, innerRadius * s0, outerRadius * c0, outerRadius * s0),
+                    segmentDistance(dx, dz, innerRadius * c1, innerRadius * s1, outerRadius * c1, outerRadius * s1));
+}
+// Fold one barrier into every sample within band of its bounds
+template <typename Distance>
+static void splat(DistanceField &field, float x1, float z1, float x2, float z2, Distance distance) {
+    int c1 = std::max(0, (int)std::floor((x1 - field.band - field.minX) / field.cellSize));
+    int c2 = std::min(field.cols - 1, (int)std::ceil((x2 + field.band - field.minX) / field.cellSize));
+    int r1 = std::max(0, (int)std::floor((z1 - field.band - field.minZ) / field.cellSize));
+    int r2 = std::min(field.rows - 1, (int)std::ceil((z2 + field.band - field.minZ) / field.cellSize));
+    for (int r = r1; r <= r2; r++) {
+        float *row = &field.distance[(size_t)r * field.cols];
+        float z = field.minZ + r * field.cellSize;
+        for (int c = c1; c <= c2; c++) {
+            float d = distance(field.minX + c * field.cellSize, z);
+            if (d < row[c]) row[c] = d;
+        }
+    }
+}
+void bakeDistanceField(DistanceField &field, float boxes[][6], int numBoxes, float circles[][7], int numCircles,
+                       float cellSize, float band, long maxSamples) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Extent of every barrier plus the band
+    float minX = INFINITY, minZ = INFINITY, maxX = -INFINITY, maxZ = -INFINITY;
+    for (int i = 0; i < numBoxes; i++) {
+        minX = std::min(minX, std::min(boxes[i][0], boxes[i][3]));
+        maxX = std::max(maxX, std::max(boxes[i][0], boxes[i][3]));
+        minZ = std::min(minZ, std::min(boxes[i][2], boxes[i][5]));
+        maxZ = std::max(maxZ, std::max(boxes[i][2], boxes[i][5]));
+    }
+    for (int i = 0; i < numCircles; i++) {
+        float radius = std::max(circles[i][3], circles[i][4]);
+        minX = std::min(minX, circles[i][0] - radius);
+        maxX = std::max(maxX, circles[i][0] + radius);
+        minZ = std::min(minZ, circles[i][2] - radius);
+        maxZ = std::max(maxZ, circles[i][2] + radius);
+    }
+    if (numBoxes + numCircles == 0) minX = minZ = maxX = maxZ = 0;
+
+    field.cellSize = cellSize;
+    field.band = band;
+    field.minX = minX - band;
+    field.minZ = minZ - band;
+    for (;;) {
+        field.cols = (int)std::ceil((maxX + band - field.minX) / field.cellSize) + 1;
+        field.rows = (int)std::ceil((maxZ + band - field.minZ) / field.cellSize) + 1;
+        if ((long)field.cols * field.rows <= maxSamples) break;
+        field.cellSize *= 2;
+    }
+    field.distance.assign((size_t)field.cols * field.rows, band);
+
+    for (int i = 0; i < numBoxes; i++) {
+        const float *box = boxes[i];
+        splat(field, std::min(box[0], box[3]), std::min(box[2], box[5]), std::max(box[0], box[3]), std::max(box[2], box[5]),
+              [box](float x, float z) { return boxDistance(x, z, box); });
+    }
+    for (int i = 0; i < numCircles; i++) {
+        const float *circle = circles[i];
+        float radius = std::max(circle[3], circle[4]);
+        splat(field, circle[0] - radius, circle[2] - radius, circle[0] + radius, circle[2] + radius,
+              [circle](float x, float z) { return circleDistance(x, z, circle); });
+    }
+    for (float &d : field.distance) d = std::min(d, band);
+
+    field.bakeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+float sampleDistanceField(const DistanceField &field, float x, float z, float *normalX, float *normalZ) {
+    float u = (x - field.minX) / field.cellSize;
+    float v = (z - field.minZ) / field.cellSize;
+    if (!(u >= 0 && v >= 0 && u < field.cols - 1 && v < field.rows - 1)) { // Off the raster: open track
+        if (normalX) *normalX = 0;
+        if (normalZ) *normalZ = 0;
+        return field.band;
+    }
+
+    int c = (int)u, r = (int)v;
+    float fu = u - c, fv = v - r;
+    const float *d0 = &field.distance[(size_t)r * field.cols + c];
+    const float *d1 = d0 + field.cols;
+    float top = d0[0] + (d0[1] - d0[0]) * fu;
+    float bottom = d1[0] + (d1[1] - d1[0]) * fu;
+
+    if (normalX || normalZ) {
+        // Analytic gradient of the bilinear patch
+        float gx = (d0[1] - d0[0]) * (1 - fv) + (d1[1] - d1[0]) * fv;
+        float gz = bottom - top;
+        float length = std::sqrt(gx * gx + gz * gz);
+        if (length > 0) { gx /= length; gz /= length; }
+        if (normalX) *normalX = gx;
+        if (normalZ) *normalZ = gz;
+    }
+    return top + (bottom - top) * fv;
+}
+float sweepDistanceField(const DistanceField &field, float x0, float z0, float x1, float z1, float radius) {
+    // Shortest step taken near a barrier. Well under the thinnest barrier, so
+    // nothing is skipped; the caller pushes out of the shallow contacts it leaves.
+    const float minStep = 2.5f;
+
+    float moveX = x1 - x0, moveZ = z1 - z0;
+    float length = std::sqrt(moveX * moveX + moveZ * moveZ);
+    if (length == 0) return 1;
+
+    // The start position was resolved by the previous move, so tracing begins one step in
+    float t = 0;
+    float gap = sampleDistanceField(field, x0, z0) - radius;
+    for (;;) {
+        t = std::min(1.0f, t + std::max(gap, minStep) / length);
+        gap = sampleDistanceField(field, x0 + t * moveX, z0 + t * moveZ) - radius;
+        if (gap < 0) return t;
+        if (t >= 1) return 1;
+    }
+}
@@ -0,0 +1,42 @@
+/******************************************
+*
+* 2D signed-distance field of the track barriers over the XZ plane.
+* Baked once from the barrier arrays; a collision query is then a single
+* bilinear lookup that also yields penetration depth and contact normal.
+*
+*******************************************/
+
+#ifndef DISTANCEFIELD_H
+#define DISTANCEFIELD_H
+
+#include <vector>
+#include <cstddef>
+
+struct DistanceField {
+    float minX = 0, minZ = 0;  // World position of sample (0, 0)
+    float cellSize = 1;        // Spacing between samples
+    float band = 0;            // Distances are clamped to this; farther away reads as open track
+    int cols = 0, rows = 0;    // Sample counts along X and Z
+    std::vector<float> distance;  // Row-major samples, negative inside a barrier
+
+    // Bake statistics
+    double bakeMilliseconds = 0;
+    size_t bytes() const { return distance.size() * sizeof(float); }
+};
+
+// Bake the field with samples cellSize apart. Only distances up to band are
+// resolved, so bake time grows with barrier count rather than track area squared.
+// The cell size grows if the track is so large that the field would exceed maxSamples.
+void bakeDistanceField(DistanceField &field, float boxes[][6], int numBoxes, float circles[][7], int numCircles,
+                       float cellSize = 1.0f, float band = 16.0f, long maxSamples = 1L << 26);
+
+// Bilinearly interpolated signed distance at (x, z). When normalX/normalZ are
+// given they receive the unit gradient, pointing away from the nearest barrier.
+float sampleDistanceField(const DistanceField &field, float x, float z, float *normalX = nullptr, float *normalZ = nullptr);
+
+// Sphere-trace a circle of the given radius from (x0, z0) to (x1, z1), stepping
+// by the clearance the field reports. Returns the fraction of the move at the
+// first sample that overlaps a barrier, 1 if the path is clear.
+float sweepDistanceField(const DistanceField &field, float x0, float z0, float x1, float z1, float radius);
+
+#endif
@@ -0,0 +1,103 @@
+/******************************************
+*
+* Ghost laps.
+*
+*******************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ghost.h"
+
+#define GHOST_MAGIC "GHST"
+#define GHOST_VERSION 1
+
+bool recordGhostTick(GhostRecorder &recorder, const SimState &state, int simEvents) {
+    if (simEvents & SIM_EVENT_LAP_STARTED) {
+        recorder.samples.clear();
+        recorder.recording = true;
+    }
+    if (!recorder.recording) return false;
+    bool completed = simEvents & SIM_EVENT_LAP_COMPLETED;
+    if (!state.timerRunning && !completed) { // Reset mid-lap
+        recorder.recording = false;
+        return false;
+    }
+    recorder.samples.push_back({state.meX, state.meZ, state.angleX, state.wheelAngle});
+    if (completed) recorder.recording = false;
+    return completed;
+}
+
+bool saveGhost(const char *path, const GhostRecorder &recorder, double lapSeconds) {
+    if (recorder.samples.empty()) return false;
+    std::string temporary = std::string(path) + ".tmp";
+    int file = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) return false;
+    size_t sampleBytes = recorder.samples.size() * sizeof(GhostSample);
+    size_t bytes = sizeof(GhostHeader) + sampleBytes;
+    void *mapping = ftruncate(file, bytes) == 0 ? mmap(nullptr, bytes, PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+    close(file);
+    if (mapping == MAP_FAILED) {
+        unlink(temporary.c_str());
+        return false;
+    }
+
+    GhostHeader *header = (GhostHeader *)mapping;
+    memcpy(header->magic, GHOST_MAGIC, 4);
+    header->version = GHOST_VERSION;
+    header->tickSeconds = recorder.tickSeconds;
+    header->sampleCount = (uint32_t)recorder.samples.size();
+    header->lapSeconds = lapSeconds;
+    memcpy(header + 1, recorder.samples.data(), sampleBytes);
+    bool ok = munmap(mapping, bytes) == 0;
+    return ok && rename(temporary.c_str(), path) == 0;
+}
+
+bool mapGhost(Ghost &ghost, const char *path) {
+    unmapGhost(ghost);
+    int file = open(path, O_RDONLY);
+    if (file < 0) return false;
+    struct stat info;
+    void *mapping = MAP_FAILED;
+    size_t bytes = 0;
+    if (fstat(file, &info) == 0 && (size_t)info.st_size >= sizeof(GhostHeader)) {
+        bytes = info.st_size;
+        mapping = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    close(file); // The mapping keeps the file open
+    if (mapping == MAP_FAILED) return false;
+
+    const GhostHeader *header = (const GhostHeader *)mapping;
+    if (memcmp(header->magic, GHOST_MAGIC, 4) != 0 || header->version != GHOST_VERSION || !(header->tickSeconds > 0) ||
+        header->sampleCount == 0 || bytes < sizeof(GhostHeader) + header->sampleCount * sizeof(GhostSample)) {
+        munmap(mapping, bytes);
+        return false;
+    }
+    ghost.header = header;
+    ghost.samples = (const GhostSample *)(header + 1);
+    ghost.mapping = mapping;
+    ghost.mappedBytes = bytes;
+    return true;
+}
+void unmapGhost(Ghost &ghost) {
+    if (ghost.mapping) munmap(ghost.mapping, ghost.mappedBytes);
+    ghost = Ghost();
+}
+
+GhostSample ghostPose(const Ghost &ghost, double lapSeconds) {
+    const GhostSample *samples = ghost.samples;
+    uint32_t last = ghost.header->sampleCount - 1;
+    double position = lapSeconds / ghost.header->tickSeconds;
+    if (!(position > 0)) return samples[0];
+    if (position >= last) return samples[last];
+    uint32_t i = (uint32_t)position;
+    float f = (float)(position - i);
+    const GhostSample &a = samples[i], &b = samples[i + 1];
+    return {a.x + f * (b.x - a.x), a.z + f * (b.z - a.z),
+            a.heading + f * (b.heading - a.heading), a.wheelAngle + f * (b.wheelAngle - a.wheelAngle)};
+}
@@ -0,0 +1,66 @@
+/******************************************
+*
+* Ghost laps. The car's pose on every tick of a completed lap is written
+* to a small binary file; later runs map the file read-only and replay the
+* pose at any lap time with an index computation and one interpolation,
+* so any number of ghosts cost no parsing or heap allocation. No GL/GLUT
+* dependencies.
+*
+*******************************************/
+
+#ifndef GHOST_H
+#define GHOST_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "simulation.h"
+
+// Car pose on one tick; the file is a GhostHeader followed by one of these per tick
+struct GhostSample {
+    float x, z;
+    float heading;     // Degrees, unwrapped like SimState::angleX
+    float wheelAngle;
+};
+struct GhostHeader {
+    char magic[4];          // "GHST"
+    uint32_t version;
+    float tickSeconds;      // Time between samples; sample 0 is the tick the lap started on
+    uint32_t sampleCount;
+    double lapSeconds;
+};
+
+// Samples of the lap being driven
+struct GhostRecorder {
+    std::vector<GhostSample> samples;
+    float tickSeconds = SIM_TICK_SECONDS;
+    bool recording = false;  // From the lap start until it completes or the car is reset
+};
+
+// After each tick: its SIM_EVENT_* flags and the state it left. Returns true
+// when the tick completed a lap, whose samples are then in recorder.samples.
+bool recordGhostTick(GhostRecorder &recorder, const SimState &state, int simEvents);
+
+// Write a completed lap to path. Goes through a temporary file and a rename,
+// so ghosts already mapped from path keep their old contents.
+bool saveGhost(const char *path, const GhostRecorder &recorder, double lapSeconds);
+
+// A ghost lap mapped from its file
+struct Ghost {
+    const GhostHeader *header = nullptr;
+    const GhostSample *samples = nullptr;
+    void *mapping = nullptr;
+    size_t mappedBytes = 0;
+    bool loaded() const { return header != nullptr; }
+};
+
+// Map a file written by saveGhost(); false if it is missing or malformed
+bool mapGhost(Ghost &ghost, const char *path);
+void unmapGhost(Ghost &ghost);
+
+// Pose lapSeconds into the lap, interpolated between the two samples around
+// it. Before the start it waits at the first sample, after the end at the last.
+GhostSample ghostPose(const Ghost &ghost, double lapSeconds);
+
+#endif
@@ -0,0 +1,66 @@
+/******************************************
+*
+* Lock-free handoff between two threads. A triple buffer passes the latest
+* value from a writer to a reader: neither ever waits for the other, the
+* reader always sees a whole value, and values the reader was too slow
+* for are skipped. A single-producer, single-consumer ring passes every
+* message in order. No GL/GLUT dependencies.
+*
+*******************************************/
+
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <atomic>
+#include <cstddef>
+
+// Three slots: the writer fills its back slot and swaps it with the middle one;
+// the reader swaps its front slot with the middle one when that holds a newer value
+template <typename T>
+struct TripleBuffer {
+    T slots[3];
+    std::atomic<int> middle{1};  // Slot index, plus FRESH once published and not yet taken
+    int back = 0, front = 2;
+    static const int FRESH = 4;
+
+    // Writer: fill this, then publish() it
+    T &writeSlot() { return slots[back]; }
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+    }
+
+    // Reader: take the newest published value if there is one (returns false if
+    // nothing was published since the last call), then read it until the next call
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+        return true;
+    }
+    const T &readSlot() const { return slots[front]; }
+};
+
+// Fixed-capacity ring; one thread pushes, one other thread pops
+template <typename T, size_t N>
+struct SpscQueue {
+    T items[N];
+    std::atomic<size_t> head{0}, tail{0};  // Next to pop, next to push; both only grow
+
+    // Producer: false (and the item is dropped) if the ring is full
+    bool push(const T &item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) return false;
+        items[t % N] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    // Consumer: the oldest item, or nullptr if empty; pop() removes it
+    const T *peek() const {
+        size_t h = head.load(std::memory_order_relaxed);
+        return h == tail.load(std::memory_order_acquire) ? nullptr : &items[h % N];
+    }
+    void pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+#endif
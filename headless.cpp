@@ -0,0 +1,339 @@
+/******************************************
+*
+* Headless simulation runner. Steps the simulation core without any
+* window or GL context and reports the achieved tick rate.
+*
+* Usage: headless [--track file] [--profile] [--field cellSize] [--swept dt] [ticks]
+*        headless [--track file] [--field cellSize] [--swept dt] --batch cars [ticks]
+*        headless [--track file] --sector-bench [queries]
+*        headless [--track file] [--field cellSize] [--swept dt] --record file [ticks]
+*        headless [--track file] --replay file
+*        headless --convert-track in out
+*        headless --generate-track pieces out
+*
+* --track runs on another track file instead of tracks/default.track;
+* --convert-track rewrites a track file as binary, or as text if out ends
+* in .txt, and reports how long each form takes to load. --generate-track
+* writes a procedural serpentine track of the given number of pieces.
+* --field switches collision to the baked distance field at the given
+* resolution and reports its size and bake time. --swept enables swept
+* collision and steps dt seconds per tick instead of SIM_TICK_SECONDS.
+* --profile times each simulation phase per tick and prints percentiles.
+* --record logs a driver's inputs like racing --record does: one that laps
+* the default track by waypoints, or the scripted one on other tracks;
+* --replay steps a recording at full speed and checks where it ends and
+* every lap time. It refuses truncated or corrupt files.
+*
+*******************************************/
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "simulation.h"
+#include "batch.h"
+#include "distancefield.h"
+#include "sector.h"
+#include "track.h"
+#include "trackgen.h"
+#include "profile.h"
+#include "replay.h"
+
+using namespace std;
+
+// Scripted driver: full throttle, sweeping the wheel left and right
+int scriptedInputs(long tick, int car) {
+    int phase = ((tick + car * 37) / 90) % 3;
+    return SIM_INPUT_ACCELERATE | (phase == 1 ? SIM_INPUT_STEER_LEFT : 0) | (phase == 2 ? SIM_INPUT_STEER_RIGHT : 0);
+}
+// Waypoints along the middle of the default track, from the start line round to it again
+const float lapPath[][2] = {
+    {240, 110}, {215, 140}, {195, 162}, {170, 185}, {160, 210}, {160, 280}, {137, 337}, {80, 360}, {23, 337},
+    {0, 280}, {-14, 254}, {-40, 240}, {-200, 240}, {-228, 228}, {-240, 200}, {-240, -320}, {-220, -350},
+    {-180, -358}, {-80, -358}, {-45, -340}, {-39, -300}, {-39, -110}, {-69, -69}, {-97, 0}, {-69, 69}, {0, 97},
+    {69, 69}, {97, 0}, {69, -69}, {39, -120}, {39, -320}, {60, -355}, {100, -358}, {240, -358}, {278, -320},
+    {200, -288}, {130, -285}, {112, -250}, {125, -215}, {160, -200}, {215, -200}, {245, -175}, {248, -140}, {248, 0}
+};
+const int lapPathCount = sizeof(lapPath) / sizeof(lapPath[0]);
+// Lapping driver for the default track: steers at the next waypoint, lifts off
+// in tight turns and reverses out when facing away from it or off a wall
+int lapDriverInputs(const SimState &state, int &waypoint) {
+    const float reach = 15, fullThrottleTurn = 30;
+    for (;;) { // Skip waypoints reached or already passed
+        const float *at = lapPath[waypoint], *next = lapPath[(waypoint + 1) % lapPathCount];
+        float dx = at[0] - state.meX, dz = at[1] - state.meZ;
+        bool passed = (state.meX - at[0]) * (next[0] - at[0]) + (state.meZ - at[1]) * (next[1] - at[1]) > 0;
+        if (dx * dx + dz * dz > reach * reach && !passed) break;
+        waypoint = (waypoint + 1) % lapPathCount;
+    }
+    float dx = lapPath[waypoint][0] - state.meX, dz = lapPath[waypoint][1] - state.meZ;
+    float turn = fmod(atan2(dx, dz) * 180 / PI - state.angleX, 360);
+    if (turn > 180) turn -= 360;
+    if (turn < -180) turn += 360;
+
+    int flags = 0;
+    bool reverse = state.velocity < 0 ? fabs(turn) > 45 : fabs(turn) > 120 && state.velocity < 0.5f;
+    if (reverse) flags |= SIM_INPUT_BRAKE;
+    else if (fabs(turn) < fullThrottleTurn || state.velocity < 1) flags |= SIM_INPUT_ACCELERATE;
+    bool left = turn > 2, right = turn < -2;
+    if (state.velocity < 0) swap(left, right); // Steering works the other way in reverse
+    if (left) flags |= SIM_INPUT_STEER_LEFT;
+    else if (right) flags |= SIM_INPUT_STEER_RIGHT;
+    return flags;
+}
+SimParams params;
+float tickSeconds = SIM_TICK_SECONDS;
+
+void runSingle(long ticks) {
+    SimState state;
+    state.params = params;
+    resetSimulation(state); // At the track's start
+    SimInputs inputs;
+    int laps = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < ticks; i++) {
+        int flags = scriptedInputs(i, 0);
+        inputs.accelerate = flags & SIM_INPUT_ACCELERATE;
+        inputs.steerLeft = flags & SIM_INPUT_STEER_LEFT;
+        inputs.steerRight = flags & SIM_INPUT_STEER_RIGHT;
+        if (stepSimulation(state, inputs, tickSeconds) & SIM_EVENT_LAP_COMPLETED) {
+            laps++;
+            resetSimulation(state);
+        }
+        if (profilingEnabled) endProfileFrame();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Ticks: " << ticks << endl;
+    cout << "Simulated time: " << ticks * tickSeconds << " s" << endl;
+    cout << "Wall time: " << seconds << " s" << endl;
+    cout << "Ticks per second: " << ticks / seconds << endl;
+    cout << "Final position: " << state.meX << ", " << state.meZ << " heading " << state.angleX << endl;
+    cout << "Laps completed: " << laps << endl;
+    for (int s = 0; profilingEnabled && s < profileSectionCount(); ++s) {
+        ProfileStats stats = profileStats(s);
+        cout << profileSectionName(s) << ": p50 " << stats.p50 * 1000 << " us, p99 " << stats.p99 * 1000
+             << " us, max " << stats.max * 1000 << " us over the last " << stats.samples << " ticks" << endl;
+    }
+}
+// Record the lapping driver, or the scripted one off the default track, with a reset after every lap
+void runRecord(const char *path, long ticks, float fieldCellSize, bool defaultTrack) {
+    SimState state;
+    state.params = params;
+    resetSimulation(state); // At the track's start
+    InputRecording recording;
+    beginRecording(recording, state, fieldCellSize, InputSettings());
+    recording.tickSeconds = tickSeconds;
+    int waypoint = 0;
+    for (long i = 0; i < ticks; i++) {
+        SimInputs inputs = inputsFromFlags(defaultTrack ? lapDriverInputs(state, waypoint) : scriptedInputs(i, 0));
+        int events = stepSimulation(state, inputs, tickSeconds);
+        recordTick(recording, inputFlags(inputs), events, state);
+        if (events & SIM_EVENT_LAP_COMPLETED) {
+            applyInputEvent(state, INPUT_RESET, recording.settings);
+            recordEvent(recording, INPUT_RESET);
+            waypoint = 0;
+        }
+    }
+    endRecording(recording, state);
+    if (!saveRecording(recording, path)) {
+        cout << "Could not write " << path << endl;
+        exit(1);
+    }
+    cout << "Recorded " << ticks << " ticks (" << ticks * tickSeconds / 60 << " simulated minutes) in "
+         << recording.bits.size() << " bytes of input, " << recording.lapTimes.size() << " laps" << endl;
+}
+int runReplay(const char *path) {
+    InputRecording recording;
+    if (!loadRecording(recording, path)) {
+        cout << "Could not read " << path << endl;
+        return 1;
+    }
+    ReplayResult result = replayRecording(recording);
+    const SimState &end = recording.end;
+    cout << "Ticks: " << recording.ticks << " (" << recording.ticks * recording.tickSeconds / 60 << " simulated minutes, "
+         << recording.bits.size() << " bytes of input)" << endl;
+    cout << "Replay time: " << result.milliseconds << " ms" << endl;
+    cout << "Ticks per second: " << recording.ticks / (result.milliseconds / 1000) << endl;
+    cout << "Final position: " << result.state.meX << ", " << result.state.meZ << " heading " << result.state.angleX
+         << " (recorded " << end.meX << ", " << end.meZ << " heading " << end.angleX << ")" << endl;
+    cout << "Laps completed: " << result.lapTimes.size() << " (recorded " << recording.lapTimes.size() << ")";
+    cout << (result.lapTimes == recording.lapTimes ? ", every lap time identical" : ", lap times differ") << endl;
+    if (!result.lapTimes.empty()) cout << "Last lap: " << result.lapTimes.back() << " s" << endl;
+    cout << (result.matches ? "Replay matches the recording" : "Replay DIVERGED from the recording") << endl;
+    return result.matches ? 0 : 2;
+}
+void runBatch(int cars, long ticks) {
+    BatchSim batch;
+    initBatch(batch, cars);
+    batch.params = params;
+    int laps = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < ticks; i++) {
+        for (int c = 0; c < cars; c++) batch.inputs[c] = scriptedInputs(i, c);
+        laps += stepBatch(batch, tickSeconds);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Cars: " << cars << " (SIMD width " << batchSimdWidth() << ")" << endl;
+    cout << "Ticks: " << ticks << endl;
+    cout << "Wall time: " << seconds << " s" << endl;
+    cout << "Batch ticks per second: " << ticks / seconds << endl;
+    cout << "Car ticks per second: " << (double)cars * ticks / seconds << endl;
+    cout << "Laps completed: " << laps << endl;
+}
+// Time one curved-barrier kernel over the query points; returns queries per second
+template <typename Query>
+double timeQueries(const char *name, const vector<float> &points, vector<char> &hits, Query query) {
+    auto start = chrono::steady_clock::now();
+    long count = 0;
+    for (size_t i = 0; i < hits.size(); i++) {
+        hits[i] = query(points[i * 2], points[i * 2 + 1]);
+        count += hits[i];
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << name << ": " << hits.size() / seconds / 1e6 << " M queries/s (" << count << " hits)" << endl;
+    return hits.size() / seconds;
+}
+// Radians either side of an arc end inside which the two curved barrier tests may disagree
+#define SECTOR_END_TOLERANCE 1e-5
+// True if (x, z) is on a curved barrier's ring and within tolerance radians of one of its arc ends
+bool nearSectorEnd(float x, float z, double tolerance) {
+    for (int i = 0; i < curveBarriersCount; i++) {
+        const float *circle = curveBarriers[i];
+        double dx = x - circle[0], dz = z - circle[2];
+        double radius = sqrt(dx * dx + dz * dz);
+        if (radius > circle[3] + 6 || radius < circle[4] - 6) continue; // Car radius, as in isInsideCircle()
+        double degrees = atan2(dz, dx) * 180 / M_PI;
+        if (degrees < 0) degrees += 360;
+        // The ends as isWithinAngles() normalises them
+        float ends[2] = {(float)fmod((float)(circle[5] * 180.0 / PI), 360), (float)fmod((float)(circle[6] * 180.0 / PI), 360)};
+        for (float end : ends) {
+            double off = fabs(degrees - end);
+            if (std::min(off, 360 - off) * M_PI / 180 < tolerance) return true;
+        }
+    }
+    return false;
+}
+// Compare the atan2-based curved barrier test with the sector kernel
+void runSectorBench(long queries) {
+    vector<float> points(queries * 2);
+    srand(1);
+    for (long i = 0; i < queries; i++) {
+        points[i * 2] = -400 + 800 * (rand() / (float)RAND_MAX);
+        points[i * 2 + 1] = -500 + 1000 * (rand() / (float)RAND_MAX);
+    }
+    SectorTable table;
+    buildSectorTable(table, curveBarriers, curveBarriersCount);
+    vector<char> expected(queries), scalar(queries), simd(queries);
+
+    cout << "Curved barriers: " << curveBarriersCount << " (SIMD width " << batchSimdWidth() << ")" << endl;
+    double before = timeQueries("isInsideAnyCircle (atan2/fmod)", points, expected, [](float x, float z) {
+        return isInsideAnyCircle(x, z, curveBarriers, curveBarriersCount) != 0;
+    });
+    timeQueries("sectorHit (scalar)", points, scalar, [&table](float x, float z) {
+        bool hit = false;
+        for (int i = 0; i < table.count && !hit; i++) hit = sectorHit(table, i, x, z);
+        return hit;
+    });
+    double after = timeQueries("anySectorHit (SIMD)", points, simd, [&table](float x, float z) {
+        return anySectorHit(table, 0, table.count, x, z);
+    });
+
+    // Points this close to an end of a barrier's arc can land either side of it:
+    // the original rounds its angle to float degrees, the kernel its cross product
+    long mismatches = 0, rounding = 0;
+    for (long i = 0; i < queries; i++) {
+        if (expected[i] == scalar[i] && expected[i] == simd[i]) continue;
+        if (nearSectorEnd(points[i * 2], points[i * 2 + 1], SECTOR_END_TOLERANCE)) rounding++;
+        else mismatches++;
+    }
+    cout << "Speedup: " << after / before << "x, mismatches: " << mismatches << " (plus " << rounding
+         << " within " << SECTOR_END_TOLERANCE << " rad of an arc end)" << endl;
+}
+// Load a track in one form, save it in the other and time loading both
+int runConvertTrack(const char *in, const char *out) {
+    auto start = chrono::steady_clock::now();
+    if (!loadTrack(in)) return 1;
+    double loadMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    size_t length = strlen(out);
+    bool text = length > 4 && strcmp(out + length - 4, ".txt") == 0;
+    if (!(text ? saveTrackText(out) : saveTrack(out))) return 1;
+    start = chrono::steady_clock::now();
+    if (!loadTrack(out)) return 1;
+    double reloadMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "Barriers: " << axisBarriersCount << " straight, " << curveBarriersCount << " curved" << endl;
+    cout << "Floor: " << trackQuadsCount << " quads, " << trackCurvesCount << " curves" << endl;
+    cout << "Trees: " << trackTreesCount << ", checkpoints: " << checkpointsCount << endl;
+    cout << "Loaded " << in << " in " << loadMilliseconds << " ms, " << out << " in " << reloadMilliseconds << " ms" << endl;
+    return 0;
+}
+// Generate a track and save it in the form out's extension asks for
+int runGenerateTrack(int pieces, const char *out) {
+    TrackBuilder track;
+    generateTrack(track, pieces);
+    if (!setTrack(track)) return 1;
+    size_t length = strlen(out);
+    bool text = length > 4 && strcmp(out + length - 4, ".txt") == 0;
+    if (!(text ? saveTrackText(out) : saveTrack(out))) return 1;
+    cout << "Barriers: " << axisBarriersCount << " straight, " << curveBarriersCount << " curved" << endl;
+    cout << "Floor: " << trackQuadsCount << " quads, " << trackCurvesCount << " curves" << endl;
+    return 0;
+}
+int main(int argc, char **argv)
+{
+    if (argc > 3 && strcmp(argv[1], "--convert-track") == 0) {
+        return runConvertTrack(argv[2], argv[3]);
+    }
+    if (argc > 3 && strcmp(argv[1], "--generate-track") == 0) {
+        return runGenerateTrack(atoi(argv[2]), argv[3]);
+    }
+    const char *trackPath = DEFAULT_TRACK_PATH;
+    if (argc > 2 && strcmp(argv[1], "--track") == 0) {
+        trackPath = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
+    if (!loadTrack(trackPath)) return 1;
+    if (argc > 1 && strcmp(argv[1], "--profile") == 0) {
+        profilingEnabled = true;
+        argc -= 1;
+        argv += 1;
+    }
+    float fieldCellSize = 0;
+    if (argc > 2 && strcmp(argv[1], "--field") == 0) {
+        fieldCellSize = atof(argv[2]);
+        bakeTrackDistanceField(fieldCellSize);
+        params.distanceFieldCollision = true;
+        const DistanceField &field = trackDistanceField();
+        cout << "Distance field: " << field.cols << "x" << field.rows << " samples, "
+             << field.bytes() / 1024 << " KB, baked in " << field.bakeMilliseconds << " ms" << endl;
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc > 2 && strcmp(argv[1], "--swept") == 0) {
+        params.sweptCollision = true;
+        tickSeconds = atof(argv[2]);
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc > 2 && strcmp(argv[1], "--replay") == 0) {
+        return runReplay(argv[2]);
+    } else if (argc > 2 && strcmp(argv[1], "--record") == 0) {
+        runRecord(argv[2], argc > 3 ? atol(argv[3]) : 225000, fieldCellSize, strcmp(trackPath, DEFAULT_TRACK_PATH) == 0);
+    } else if (argc > 1 && strcmp(argv[1], "--sector-bench") == 0) {
+        runSectorBench(argc > 2 ? atol(argv[2]) : 10000000);
+    } else if (argc > 2 && strcmp(argv[1], "--batch") == 0) {
+        runBatch(atoi(argv[2]), argc > 3 ? atol(argv[3]) : 1000);
+    } else {
+        runSingle(argc > 1 ? atol(argv[1]) : 10000000);
+    }
+    return 0;
+}
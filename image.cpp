@@ -0,0 +1,143 @@
+/******************************************
+*
+* Image decoding for textures.
+*
+*******************************************/
+
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "image.h"
+
+#define MAX_IMAGE_SIZE 16384  // Largest width or height accepted from a file
+
+void initImage(Image &image, int width, int height, int channels) {
+    image = Image();
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.pixels.resize((size_t)width * height * channels);
+    ImageLevel level;
+    level.width = width;
+    level.height = height;
+    image.levels.push_back(level);
+}
+
+void swizzleBgrToRgb(unsigned char *dst, const unsigned char *src, size_t count) {
+    size_t bytes = count * 3, i = 0;
+#if defined(__SSE2__)
+    // Four pixels per step: red comes from two bytes on, blue from two bytes back.
+    // The last pixel of each 16-byte store is wrong and rewritten by the next step.
+    const __m128i red = _mm_setr_epi8(-1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1);
+    const __m128i green = _mm_setr_epi8(0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0);
+    const __m128i blue = _mm_setr_epi8(0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0);
+    for (; i + 16 <= bytes; i += 12) {
+        __m128i bgr = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i rgb = _mm_or_si128(_mm_and_si128(_mm_srli_si128(bgr, 2), red),
+                                   _mm_or_si128(_mm_and_si128(bgr, green), _mm_and_si128(_mm_slli_si128(bgr, 2), blue)));
+        _mm_storeu_si128((__m128i *)(dst + i), rgb);
+    }
+#endif
+    for (; i < bytes; i += 3) {
+        dst[i] = src[i + 2];
+        dst[i + 1] = src[i + 1];
+        dst[i + 2] = src[i];
+    }
+}
+
+/*\ ---- BMP files ---- \*/
+static bool imageError(const char *path, const char *why) {
+    std::cerr << "Image " << path << ": " << why << std::endl;
+    return false;
+}
+// Header fields are little-endian and unaligned
+static uint32_t read32(const unsigned char *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+static uint16_t read16(const unsigned char *p) {
+    return p[0] | p[1] << 8;
+}
+bool loadBmp(Image &image, const char *path) {
+    image = Image();
+    int file = open(path, O_RDONLY);
+    if (file < 0) return imageError(path, "cannot open");
+    struct stat info;
+    void *mapping = MAP_FAILED;
+    size_t bytes = 0;
+    if (fstat(file, &info) == 0 && info.st_size >= 54) { // File header and BITMAPINFOHEADER
+        bytes = info.st_size;
+        mapping = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    close(file); // The mapping keeps the file open
+    if (mapping == MAP_FAILED) return imageError(path, "truncated header");
+    madvise(mapping, bytes, MADV_SEQUENTIAL);
+
+    const unsigned char *data = (const unsigned char *)mapping;
+    uint32_t offset = read32(data + 10), headerSize = read32(data + 14);
+    int64_t width = (int32_t)read32(data + 18), height = (int32_t)read32(data + 22);
+    uint16_t planes = read16(data + 26), bitsPerPixel = read16(data + 28);
+    uint32_t compression = read32(data + 30);
+    int64_t rows = std::abs(height);
+    size_t stride = ((size_t)width * 3 + 3) & ~(size_t)3; // File rows are padded to 4 bytes
+
+    const char *why = nullptr;
+    if (memcmp(data, "BM", 2) != 0) why = "not a BMP file";
+    else if (headerSize < 40) why = "unsupported BMP header";
+    else if (planes != 1 || bitsPerPixel != 24 || compression != 0) why = "only uncompressed 24-bit BMP files are supported";
+    else if (width <= 0 || rows == 0 || width > MAX_IMAGE_SIZE || rows > MAX_IMAGE_SIZE) why = "bad dimensions";
+    else if (offset > bytes || stride * rows > bytes - offset) why = "pixel data outside the file";
+    if (!why) {
+        // Positive heights are stored bottom row first, like GL; negative ones top first
+        initImage(image, (int)width, (int)rows, 3);
+        for (int64_t row = 0; row < rows; row++) {
+            int64_t fileRow = height > 0 ? row : rows - 1 - row;
+            swizzleBgrToRgb(&image.pixels[row * width * 3], data + offset + fileRow * stride, width);
+        }
+    }
+    munmap(mapping, bytes);
+    return why ? imageError(path, why) : true;
+}
+/*\ -------------------------- \*/
+
+void buildMipChain(Image &image) {
+    if (image.levels.empty()) return;
+    image.levels.resize(1);
+    int channels = image.channels;
+    size_t total = (size_t)image.width * image.height * channels;
+    for (ImageLevel level = image.levels[0]; level.width > 1 || level.height > 1;) {
+        level.offset += (size_t)level.width * level.height * channels;
+        level.width = std::max(1, level.width / 2);
+        level.height = std::max(1, level.height / 2);
+        total = level.offset + (size_t)level.width * level.height * channels;
+        image.levels.push_back(level);
+    }
+    image.pixels.resize(total);
+
+    for (size_t i = 1; i < image.levels.size(); i++) {
+        const ImageLevel &above = image.levels[i - 1], &level = image.levels[i];
+        const unsigned char *src = &image.pixels[above.offset];
+        unsigned char *dst = &image.pixels[level.offset];
+        size_t srcRow = (size_t)above.width * channels;
+        for (int y = 0; y < level.height; y++) {
+            // An odd or single row or column is averaged with itself
+            const unsigned char *row0 = src + std::min(2 * y, above.height - 1) * srcRow;
+            const unsigned char *row1 = src + std::min(2 * y + 1, above.height - 1) * srcRow;
+            for (int x = 0; x < level.width; x++) {
+                int x0 = std::min(2 * x, above.width - 1) * channels, x1 = std::min(2 * x + 1, above.width - 1) * channels;
+                for (int c = 0; c < channels; c++) {
+                    *dst++ = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,47 @@
+/******************************************
+*
+* Image decoding for textures. BMP files are memory-mapped and decoded a
+* row at a time straight from the mapping into tightly packed RGB, with
+* the BGR to RGB swizzle done several pixels per SIMD instruction; a box
+* filtered mip chain is then built on the CPU so the upload is just a
+* copy. No GL/GLUT dependencies.
+*
+*******************************************/
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <vector>
+#include <cstddef>
+
+// One mip level, stored at pixels[offset]
+struct ImageLevel {
+    int width = 0, height = 0;
+    size_t offset = 0;
+};
+
+// Rows run bottom to top, as GL expects, with no padding between them
+struct Image {
+    int width = 0, height = 0;
+    int channels = 0;                   // 1 (alpha), 3 (RGB) or 4 (RGBA)
+    std::vector<unsigned char> pixels;  // Every level, largest first
+    std::vector<ImageLevel> levels;     // Level 0 is the full image
+
+    const unsigned char *level(int i) const { return pixels.data() + levels[i].offset; }
+    size_t bytes() const { return pixels.size(); }
+};
+
+// Start an image of one level, with its pixels uninitialised
+void initImage(Image &image, int width, int height, int channels);
+
+// Decode an uncompressed 24-bit BMP file into level 0. On failure prints why
+// and leaves the image empty.
+bool loadBmp(Image &image, const char *path);
+
+// Copy count pixels from BGR to RGB order (src and dst must not overlap)
+void swizzleBgrToRgb(unsigned char *dst, const unsigned char *src, size_t count);
+
+// Append levels down to 1x1, each texel the rounded average of the 2x2 texels above it
+void buildMipChain(Image &image);
+
+#endif
@@ -0,0 +1,98 @@
+/******************************************
+*
+* Distance-based level of detail.
+*
+*******************************************/
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __APPLE__
+#  include <GLUT/glut.h>
+#else
+#  include <GL/glut.h>
+#endif
+
+#include "lod.h"
+
+const float lodDetail[LOD_LEVELS] = {1.0f, 0.5f, 0.25f, 0.125f};
+float lodPixelThresholds[LOD_LEVELS - 1] = {80.0f, 25.0f, 8.0f};
+LodCounters lodCounters;
+
+static float viewMatrix[16];   // Column-major, as returned by glGetFloatv
+static float pixelsPerUnit;    // Projected size of one unit at distance one
+
+void beginLodFrame() {
+    glGetFloatv(GL_MODELVIEW_MATRIX, viewMatrix);
+    float projection[16];
+    GLint viewport[4];
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    pixelsPerUnit = projection[5] * viewport[3] * 0.5f;
+    memset(&lodCounters, 0, sizeof(lodCounters));
+}
+float lodPixelRadius(float x, float y, float z, float radius) {
+    float depth = -(viewMatrix[2] * x + viewMatrix[6] * y + viewMatrix[10] * z + viewMatrix[14]);
+    if (depth <= radius) return INFINITY; // Camera inside or right at the object
+    return radius * pixelsPerUnit / depth;
+}
+int selectLod(float x, float y, float z, float radius) {
+    float pixels = lodPixelRadius(x, y, z, radius);
+    int level = 0;
+    while (level < LOD_LEVELS - 1 && pixels < lodPixelThresholds[level]) level++;
+    return level;
+}
+
+// Tessellation count at a level, never below minimum
+static int lodCount(int full, int level, int minimum) {
+    return std::max(minimum, (int)std::lround(full * lodDetail[level]));
+}
+void buildLodSphere(LodMesh &lod, float radius, int slices, int stacks) {
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        clearMesh(lod.levels[level]);
+        meshSphere(lod.levels[level], radius, lodCount(slices, level, 6), lodCount(stacks, level, 4));
+    }
+}
+void buildLodTorus(LodMesh &lod, float innerRadius, float outerRadius, int sides, int rings) {
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        clearMesh(lod.levels[level]);
+        meshTorus(lod.levels[level], innerRadius, outerRadius, lodCount(sides, level, 4), lodCount(rings, level, 6));
+    }
+}
+void buildLodCylinder(LodMesh &lod, float baseRadius, float topRadius, float height, int slices, int stacks) {
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        clearMesh(lod.levels[level]);
+        meshCylinder(lod.levels[level], baseRadius, topRadius, height, lodCount(slices, level, 5), lodCount(stacks, level, 1));
+    }
+}
+void buildLodDisc(LodMesh &lod, float radius, int segments) {
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        clearMesh(lod.levels[level]);
+        meshDisc(lod.levels[level], radius, lodCount(segments, level, 8));
+    }
+}
+void buildLodBezierPatch(LodMesh &lod, const float control[4][4][3], int segments, float textureScale) {
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        clearMesh(lod.levels[level]);
+        int count = lodCount(segments, level, 2);
+        meshBezierPatch(lod.levels[level], control, count, count, textureScale);
+    }
+}
+void uploadLodMesh(LodMesh &lod) {
+    for (int level = 0; level < LOD_LEVELS; ++level) uploadMesh(lod.levels[level]);
+}
+void releaseLodMesh(LodMesh &lod) {
+    for (int level = 0; level < LOD_LEVELS; ++level) releaseMesh(lod.levels[level]);
+}
+
+void countLod(const LodMesh &lod, int level, long instances) {
+    long triangles = lod.levels[level].triangleCount();
+    lodCounters.objects[level] += instances;
+    lodCounters.triangles[level] += triangles * instances;
+    lodCounters.trianglesSaved[level] += (lod.levels[0].triangleCount() - triangles) * instances;
+}
+void drawLodMesh(const LodMesh &lod, int level) {
+    countLod(lod, level);
+    drawMesh(lod.levels[level]);
+}
@@ -0,0 +1,61 @@
+/******************************************
+*
+* Distance-based level of detail. Each primitive is tessellated at
+* LOD_LEVELS resolutions; per object, the level is picked from its
+* projected radius on screen under the current camera, so distant
+* objects submit a fraction of the triangles.
+*
+*******************************************/
+
+#ifndef LOD_H
+#define LOD_H
+
+#include "mesh.h"
+
+#define LOD_LEVELS 4
+
+// Tessellation of each level relative to full detail (level 0)
+extern const float lodDetail[LOD_LEVELS];
+
+// Smallest projected radius, in pixels, at which levels 0, 1 and 2 are used;
+// anything smaller gets the last level
+extern float lodPixelThresholds[LOD_LEVELS - 1];
+
+// Per-frame counters, reset by beginLodFrame()
+struct LodCounters {
+    long objects[LOD_LEVELS];         // Draws at each level
+    long triangles[LOD_LEVELS];       // Triangles submitted at each level
+    long trianglesSaved[LOD_LEVELS];  // Triangles not submitted thanks to each level (vs. level 0)
+};
+extern LodCounters lodCounters;
+
+// Capture the camera (modelview right after gluLookAt, projection and viewport)
+// and reset the counters. Call once per frame before drawing.
+void beginLodFrame();
+
+// Projected radius in pixels of a world-space sphere, and the level it gets
+float lodPixelRadius(float x, float y, float z, float radius);
+int selectLod(float x, float y, float z, float radius);
+
+// One primitive tessellated at every level
+struct LodMesh {
+    Mesh levels[LOD_LEVELS];
+};
+
+// Build the levels from full-detail tessellation counts, scaled by lodDetail.
+// Needs no GL context; uploadLodMesh() then hands every level to GL.
+void buildLodSphere(LodMesh &lod, float radius, int slices, int stacks);
+void buildLodTorus(LodMesh &lod, float innerRadius, float outerRadius, int sides, int rings);
+void buildLodCylinder(LodMesh &lod, float baseRadius, float topRadius, float height, int slices, int stacks);
+void buildLodDisc(LodMesh &lod, float radius, int segments);
+void buildLodBezierPatch(LodMesh &lod, const float control[4][4][3], int segments, float textureScale = 1);
+void uploadLodMesh(LodMesh &lod);
+void releaseLodMesh(LodMesh &lod);
+
+// Record instances drawn at a level without drawing them (for instanced callers)
+void countLod(const LodMesh &lod, int level, long instances = 1);
+
+// Draw one level with the current modelview and record it
+void drawLodMesh(const LodMesh &lod, int level);
+
+#endif
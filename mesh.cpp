@@ -0,0 +1,397 @@
+/******************************************
+*
+* Retained-mode static meshes.
+*
+*******************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#ifdef __APPLE__
+#  include <GLUT/glut.h>
+#else
+#  define GL_GLEXT_PROTOTYPES
+#  include <GL/glut.h>
+#endif
+
+#include "mesh.h"
+
+DrawCounters drawCounters;
+
+void meshPart(Mesh &mesh) {
+    MeshPart part;
+    part.first = mesh.vertexCount();
+    mesh.parts.push_back(part);
+}
+void meshPart(Mesh &mesh, float r, float g, float b) {
+    meshPart(mesh);
+    MeshPart &part = mesh.parts.back();
+    part.hasColor = true;
+    part.color[0] = r;
+    part.color[1] = g;
+    part.color[2] = b;
+}
+void meshVertex(Mesh &mesh, const float position[3], const float normal[3], float u, float v) {
+    if (mesh.parts.empty()) meshPart(mesh);
+    float vertex[MESH_STRIDE] = {position[0], position[1], position[2], normal[0], normal[1], normal[2], u, v};
+    mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + MESH_STRIDE);
+    MeshPart &part = mesh.parts.back();
+    for (int k = 0; k < 3; ++k) {
+        part.min[k] = part.count ? std::min(part.min[k], position[k]) : position[k];
+        part.max[k] = part.count ? std::max(part.max[k], position[k]) : position[k];
+    }
+    part.count++;
+}
+// Split along b-d, as Mesa splits GL_QUADS, so vertex lighting interpolates the same way
+void meshQuad(Mesh &mesh, const float a[3], const float b[3], const float c[3], const float d[3], const float normal[3]) {
+    meshVertex(mesh, a, normal);
+    meshVertex(mesh, b, normal);
+    meshVertex(mesh, d, normal);
+    meshVertex(mesh, b, normal);
+    meshVertex(mesh, c, normal);
+    meshVertex(mesh, d, normal);
+}
+// Two triangles of a triangle strip, between vertex pairs (a0, b0) and (a1, b1)
+static void meshStripStep(Mesh &mesh, const float a0[3], const float b0[3], const float n0[3],
+                          const float a1[3], const float b1[3], const float n1[3]) {
+    meshVertex(mesh, a0, n0);
+    meshVertex(mesh, b0, n0);
+    meshVertex(mesh, a1, n1);
+    meshVertex(mesh, a1, n1);
+    meshVertex(mesh, b0, n0);
+    meshVertex(mesh, b1, n1);
+}
+// Same corners, faces and normals as drawBoxFromCorners()
+void meshBox(Mesh &mesh, float x1, float y1, float z1, float x2, float y2, float z2) {
+    float vertices[8][3] = {
+        {std::min(x1, x2), std::min(y1, y2), std::min(z1, z2)},
+        {std::max(x1, x2), std::min(y1, y2), std::min(z1, z2)},
+        {std::max(x1, x2), std::max(y1, y2), std::min(z1, z2)},
+        {std::min(x1, x2), std::max(y1, y2), std::min(z1, z2)},
+        {std::min(x1, x2), std::max(y1, y2), std::max(z1, z2)},
+        {std::max(x1, x2), std::max(y1, y2), std::max(z1, z2)},
+        {std::max(x1, x2), std::min(y1, y2), std::max(z1, z2)},
+        {std::min(x1, x2), std::min(y1, y2), std::max(z1, z2)}
+    };
+    int faces[6][4] = {{0, 1, 2, 3}, {7, 6, 5, 4}, {3, 2, 5, 4}, {0, 7, 6, 1}, {7, 4, 3, 0}, {1, 6, 5, 2}};
+    float normals[6][3] = {{0, 0, -1}, {0, 0, 1}, {0, 1, 0}, {0, -1, 0}, {-1, 0, 0}, {1, 0, 0}};
+    for (int i = 0; i < 6; ++i) {
+        meshQuad(mesh, vertices[faces[i][0]], vertices[faces[i][1]], vertices[faces[i][2]], vertices[faces[i][3]], normals[i]);
+    }
+}
+// Flat washer or partial washer in the XZ plane at height cy, as drawCircle()
+void meshRing(Mesh &mesh, float cx, float cy, float cz, float innerRadius, float outerRadius,
+              float startAngle, float endAngle, int segments) {
+    const float up[3] = {0, 1, 0};
+    float prevOuter[3], prevInner[3];
+    for (int i = 0; i <= segments; ++i) {
+        float theta = startAngle + (endAngle - startAngle) * float(i) / float(segments);
+        float cosTheta = cosf(theta);
+        float sinTheta = sinf(theta);
+        float outer[3] = {cx + outerRadius * cosTheta, cy, cz + outerRadius * sinTheta};
+        float inner[3] = {cx + innerRadius * cosTheta, cy, cz + innerRadius * sinTheta};
+        if (i > 0) meshStripStep(mesh, prevOuter, prevInner, up, outer, inner, up);
+        std::copy(outer, outer + 3, prevOuter);
+        std::copy(inner, inner + 3, prevInner);
+    }
+}
+// Inner and outer vertical faces of a curved barrier, from height cy down to 0, as drawCurvedWall()
+void meshCurvedWall(Mesh &mesh, float cx, float cy, float cz, float innerRadius, float outerRadius,
+                    float startAngle, float endAngle, int segments) {
+    for (int side = 0; side < 2; ++side) {
+        float radius = side == 0 ? innerRadius : outerRadius;
+        float facing = side == 0 ? -1.0f : 1.0f;
+        float prevTop[3], prevBottom[3], prevNormal[3];
+        for (int i = 0; i <= segments; ++i) {
+            float theta = startAngle + (endAngle - startAngle) * float(i) / float(segments);
+            float cosTheta = cosf(theta);
+            float sinTheta = sinf(theta);
+            float normal[3] = {facing * cosTheta, 0.0f, facing * sinTheta};
+            float top[3] = {cx + radius * cosTheta, cy, cz + radius * sinTheta};
+            float bottom[3] = {top[0], 0.0f, top[2]};
+            if (i > 0) meshStripStep(mesh, prevTop, prevBottom, prevNormal, top, bottom, normal);
+            std::copy(top, top + 3, prevTop);
+            std::copy(bottom, bottom + 3, prevBottom);
+            std::copy(normal, normal + 3, prevNormal);
+        }
+    }
+}
+// Follows gluCylinder() with GLU_SMOOTH normals, mapping its (x, y, z) to (x, z, -y)
+void meshCylinder(Mesh &mesh, float baseRadius, float topRadius, float height, int slices, int stacks) {
+    float deltaRadius = baseRadius - topRadius;
+    float length = std::sqrt(deltaRadius * deltaRadius + height * height);
+    if (length == 0) return;
+    float axisNormal = deltaRadius / length;
+    float radialNormal = height / length;
+
+    std::vector<float> sinCache(slices + 1), cosCache(slices + 1);
+    for (int i = 0; i < slices; ++i) {
+        float angle = 2 * M_PI * i / slices;
+        sinCache[i] = sinf(angle);
+        cosCache[i] = cosf(angle);
+    }
+    sinCache[slices] = sinCache[0];
+    cosCache[slices] = cosCache[0];
+
+    for (int j = 0; j < stacks; ++j) {
+        float lowY = j * height / stacks;
+        float highY = (j + 1) * height / stacks;
+        float lowRadius = baseRadius - deltaRadius * ((float)j / stacks);
+        float highRadius = baseRadius - deltaRadius * ((float)(j + 1) / stacks);
+        float lowV = (float)j / stacks, highV = (float)(j + 1) / stacks;
+        for (int i = 0; i < slices; ++i) {
+            // One quad of the GL_QUAD_STRIP as two triangles
+            float u0 = 1 - (float)i / slices, u1 = 1 - (float)(i + 1) / slices;
+            float n0[3] = {sinCache[i] * radialNormal, axisNormal, -cosCache[i] * radialNormal};
+            float n1[3] = {sinCache[i + 1] * radialNormal, axisNormal, -cosCache[i + 1] * radialNormal};
+            float low0[3] = {lowRadius * sinCache[i], lowY, -lowRadius * cosCache[i]};
+            float high0[3] = {highRadius * sinCache[i], highY, -highRadius * cosCache[i]};
+            float low1[3] = {lowRadius * sinCache[i + 1], lowY, -lowRadius * cosCache[i + 1]};
+            float high1[3] = {highRadius * sinCache[i + 1], highY, -highRadius * cosCache[i + 1]};
+            meshVertex(mesh, low0, n0, u0, lowV);
+            meshVertex(mesh, high0, n0, u0, highV);
+            meshVertex(mesh, low1, n1, u1, lowV);
+            meshVertex(mesh, low1, n1, u1, lowV);
+            meshVertex(mesh, high0, n0, u0, highV);
+            meshVertex(mesh, high1, n1, u1, highV);
+        }
+    }
+}
+void meshSphere(Mesh &mesh, float radius, int slices, int stacks) {
+    for (int j = 0; j < stacks; ++j) {
+        float phi0 = M_PI * j / stacks, phi1 = M_PI * (j + 1) / stacks;
+        for (int i = 0; i < slices; ++i) {
+            float theta0 = 2 * M_PI * i / slices, theta1 = 2 * M_PI * (i + 1) / slices;
+            // Unit directions of the cell corners, top row first
+            float n[4][3] = {
+                {sinf(phi0) * cosf(theta0), sinf(phi0) * sinf(theta0), cosf(phi0)},
+                {sinf(phi0) * cosf(theta1), sinf(phi0) * sinf(theta1), cosf(phi0)},
+                {sinf(phi1) * cosf(theta1), sinf(phi1) * sinf(theta1), cosf(phi1)},
+                {sinf(phi1) * cosf(theta0), sinf(phi1) * sinf(theta0), cosf(phi1)}
+            };
+            float p[4][3];
+            for (int k = 0; k < 4; ++k)
+                for (int c = 0; c < 3; ++c) p[k][c] = n[k][c] * radius;
+            if (j > 0) { // The top row collapses to the pole on the first stack
+                meshVertex(mesh, p[0], n[0]);
+                meshVertex(mesh, p[3], n[3]);
+                meshVertex(mesh, p[1], n[1]);
+            }
+            if (j < stacks - 1) { // And the bottom row on the last
+                meshVertex(mesh, p[1], n[1]);
+                meshVertex(mesh, p[3], n[3]);
+                meshVertex(mesh, p[2], n[2]);
+            }
+        }
+    }
+}
+void meshTorus(Mesh &mesh, float innerRadius, float outerRadius, int sides, int rings) {
+    for (int i = 0; i < rings; ++i) {
+        for (int j = 0; j < sides; ++j) {
+            float n[4][3], p[4][3];
+            for (int k = 0; k < 4; ++k) {
+                float theta = 2 * M_PI * (i + (k == 1 || k == 2)) / rings;
+                float phi = 2 * M_PI * (j + (k >= 2)) / sides;
+                n[k][0] = cosf(phi) * cosf(theta);
+                n[k][1] = cosf(phi) * sinf(theta);
+                n[k][2] = sinf(phi);
+                float distance = outerRadius + innerRadius * cosf(phi);
+                p[k][0] = distance * cosf(theta);
+                p[k][1] = distance * sinf(theta);
+                p[k][2] = innerRadius * sinf(phi);
+            }
+            meshVertex(mesh, p[0], n[0]);
+            meshVertex(mesh, p[1], n[1]);
+            meshVertex(mesh, p[3], n[3]);
+            meshVertex(mesh, p[1], n[1]);
+            meshVertex(mesh, p[2], n[2]);
+            meshVertex(mesh, p[3], n[3]);
+        }
+    }
+}
+void meshDisc(Mesh &mesh, float radius, int segments) {
+    const float center[3] = {0, 0, 0};
+    const float normal[3] = {0, 0, -1};
+    for (int i = 0; i < segments; ++i) {
+        float angle0 = 2.0f * M_PI * i / segments, angle1 = 2.0f * M_PI * (i + 1) / segments;
+        float a[3] = {cosf(angle0) * radius, sinf(angle0) * radius, 0};
+        float b[3] = {cosf(angle1) * radius, sinf(angle1) * radius, 0};
+        meshVertex(mesh, center, normal);
+        meshVertex(mesh, a, normal);
+        meshVertex(mesh, b, normal);
+    }
+}
+// Cubic Bernstein weights at t and their derivatives
+static void bernstein(float t, float weight[4], float slope[4]) {
+    float s = 1 - t;
+    weight[0] = s * s * s;
+    weight[1] = 3 * t * s * s;
+    weight[2] = 3 * t * t * s;
+    weight[3] = t * t * t;
+    slope[0] = -3 * s * s;
+    slope[1] = 3 * s * s - 6 * t * s;
+    slope[2] = 6 * t * s - 3 * t * t;
+    slope[3] = 3 * t * t;
+}
+void meshBezierPatch(Mesh &mesh, const float control[4][4][3], int uSegments, int vSegments, float textureScale) {
+    // Evaluate the grid once: position, then normal from the partial derivatives
+    std::vector<float> grid((size_t)(uSegments + 1) * (vSegments + 1) * 6);
+    for (int j = 0; j <= vSegments; ++j) {
+        float bv[4], dv[4];
+        bernstein((float)j / vSegments, bv, dv);
+        for (int i = 0; i <= uSegments; ++i) {
+            float bu[4], du[4];
+            bernstein((float)i / uSegments, bu, du);
+            float position[3] = {0, 0, 0}, tangentU[3] = {0, 0, 0}, tangentV[3] = {0, 0, 0};
+            for (int row = 0; row < 4; ++row) {
+                for (int col = 0; col < 4; ++col) {
+                    for (int k = 0; k < 3; ++k) {
+                        position[k] += bv[row] * bu[col] * control[row][col][k];
+                        tangentU[k] += bv[row] * du[col] * control[row][col][k];
+                        tangentV[k] += dv[row] * bu[col] * control[row][col][k];
+                    }
+                }
+            }
+            float *point = &grid[((size_t)j * (uSegments + 1) + i) * 6];
+            point[0] = position[0]; point[1] = position[1]; point[2] = position[2];
+            point[3] = tangentV[1] * tangentU[2] - tangentV[2] * tangentU[1];
+            point[4] = tangentV[2] * tangentU[0] - tangentV[0] * tangentU[2];
+            point[5] = tangentV[0] * tangentU[1] - tangentV[1] * tangentU[0];
+            float length = sqrt(point[3] * point[3] + point[4] * point[4] + point[5] * point[5]);
+            if (length > 0) { point[3] /= length; point[4] /= length; point[5] /= length; }
+        }
+    }
+
+    auto emit = [&](int i, int j) {
+        const float *point = &grid[((size_t)j * (uSegments + 1) + i) * 6];
+        meshVertex(mesh, point, point + 3, textureScale * i / uSegments, textureScale * j / vSegments);
+    };
+    for (int j = 0; j < vSegments; ++j) {
+        for (int i = 0; i < uSegments; ++i) {
+            emit(i, j);     emit(i, j + 1); emit(i + 1, j);
+            emit(i + 1, j); emit(i, j + 1); emit(i + 1, j + 1);
+        }
+    }
+}
+
+// Parsed on the first call with a current context; every mesh upload and particle frame asks
+bool meshBuffersSupported() {
+    static int supported = -1;
+    if (supported < 0) {
+        const char *version = (const char *)glGetString(GL_VERSION);
+        int major = 0, minor = 0;
+        if (!version) return false; // No context yet
+        supported = sscanf(version, "%d.%d", &major, &minor) == 2 && (major > 1 || (major == 1 && minor >= 5));
+    }
+    return supported;
+}
+void clearMesh(Mesh &mesh) {
+    mesh.vertices.clear();
+    mesh.parts.clear();
+    mesh.droppedVertices = 0;
+}
+void dropMeshVertices(Mesh &mesh) {
+    mesh.droppedVertices = mesh.vertexCount();
+    mesh.vertices = std::vector<float>();
+}
+void uploadMesh(Mesh &mesh) {
+    releaseMesh(mesh);
+    if (meshBuffersSupported()) {
+        glGenBuffers(1, &mesh.buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.buffer);
+        glBufferData(GL_ARRAY_BUFFER, mesh.bytes(), mesh.vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+
+    // Fallback: replay each part into its own display list, plus one list calling them all
+    mesh.listCount = 1 + (int)mesh.parts.size();
+    mesh.list = glGenLists(mesh.listCount);
+    for (size_t p = 0; p < mesh.parts.size(); ++p) {
+        const MeshPart &part = mesh.parts[p];
+        glNewList(mesh.list + 1 + p, GL_COMPILE);
+        if (part.hasColor) glColor3fv(part.color);
+        glBegin(GL_TRIANGLES);
+        for (int i = part.first; i < part.first + part.count; ++i) {
+            const float *vertex = &mesh.vertices[(size_t)i * MESH_STRIDE];
+            glNormal3fv(vertex + 3);
+            glTexCoord2fv(vertex + 6);
+            glVertex3fv(vertex);
+        }
+        glEnd();
+        glEndList();
+    }
+    glNewList(mesh.list, GL_COMPILE);
+    for (size_t p = 0; p < mesh.parts.size(); ++p) glCallList(mesh.list + 1 + p);
+    glEndList();
+}
+void beginMeshInstances(const Mesh &mesh) {
+    if (!mesh.buffer) return; // Display lists need no setup
+
+    const GLsizei stride = MESH_STRIDE * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.buffer);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, (const void *)0);
+    glNormalPointer(GL_FLOAT, stride, (const void *)(3 * sizeof(float)));
+    glTexCoordPointer(2, GL_FLOAT, stride, (const void *)(6 * sizeof(float)));
+}
+void drawMeshInstance(const Mesh &mesh) {
+    if (mesh.list) {
+        glCallList(mesh.list);
+        countDraw(mesh.vertexCount(), (long)mesh.parts.size()); // One glBegin() per part
+        return;
+    }
+    if (!mesh.buffer) return;
+    for (const MeshPart &part : mesh.parts) {
+        if (part.hasColor) glColor3fv(part.color);
+        glDrawArrays(GL_TRIANGLES, part.first, part.count);
+        countDraw(part.count);
+    }
+}
+void drawMeshPart(const Mesh &mesh, int part) {
+    const MeshPart &range = mesh.parts[part];
+    if (mesh.list) {
+        glCallList(mesh.list + 1 + part);
+        countDraw(range.count);
+        return;
+    }
+    if (!mesh.buffer) return;
+    if (range.hasColor) glColor3fv(range.color);
+    glDrawArrays(GL_TRIANGLES, range.first, range.count);
+    countDraw(range.count);
+}
+void drawMeshParts(const Mesh &mesh, int first, int count) {
+    if (count <= 0) return;
+    if (mesh.list) { // One list per part
+        for (int part = first; part < first + count; ++part) drawMeshPart(mesh, part);
+        return;
+    }
+    if (!mesh.buffer) return;
+    const MeshPart &start = mesh.parts[first], &end = mesh.parts[first + count - 1];
+    int vertices = end.first + end.count - start.first; // Parts are laid out in order
+    if (start.hasColor) glColor3fv(start.color);
+    glDrawArrays(GL_TRIANGLES, start.first, vertices);
+    countDraw(vertices);
+}
+void endMeshInstances(const Mesh &mesh) {
+    if (!mesh.buffer) return;
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+void drawMesh(const Mesh &mesh) {
+    beginMeshInstances(mesh);
+    drawMeshInstance(mesh);
+    endMeshInstances(mesh);
+}
+void releaseMesh(Mesh &mesh) {
+    if (mesh.buffer) glDeleteBuffers(1, &mesh.buffer);
+    if (mesh.list) glDeleteLists(mesh.list, mesh.listCount);
+    mesh.buffer = 0;
+    mesh.list = 0;
+    mesh.listCount = 0;
+}
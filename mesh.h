@@ -0,0 +1,108 @@
+/******************************************
+*
+* Retained-mode static meshes. Geometry is tessellated once into an
+* interleaved triangle list and uploaded to a vertex buffer (or compiled
+* into a display list where buffers are unavailable), so drawing it each
+* frame is a handful of GL calls instead of thousands of glVertex calls.
+*
+*******************************************/
+
+#ifndef MESH_H
+#define MESH_H
+
+#include <vector>
+#include <cstddef>
+
+#define MESH_STRIDE 8  // Floats per vertex: position xyz, normal xyz, texture uv
+
+// Consecutive triangles drawn with one colour (or the current colour)
+struct MeshPart {
+    int first = 0, count = 0;  // Vertex range
+    bool hasColor = false;
+    float color[3] = {0, 0, 0};
+    float min[3] = {0, 0, 0}, max[3] = {0, 0, 0};  // Bounding box of the part's vertices
+};
+
+struct Mesh {
+    std::vector<float> vertices;  // MESH_STRIDE floats per vertex, three vertices per triangle
+    std::vector<MeshPart> parts;
+    int droppedVertices = 0;      // Vertices uploaded and no longer kept in vertices
+    unsigned int buffer = 0;      // Vertex buffer object, if uploaded into one
+    unsigned int list = 0;        // Display lists otherwise: list draws everything, list + 1 + i draws part i
+    int listCount = 0;
+
+    int vertexCount() const { return (int)(vertices.size() / MESH_STRIDE) + droppedVertices; }
+    int triangleCount() const { return vertexCount() / 3; }
+    size_t bytes() const { return (size_t)vertexCount() * MESH_STRIDE * sizeof(float); }
+};
+
+// Start a new part. Without a colour the part uses whatever colour is current when drawn.
+void meshPart(Mesh &mesh);
+void meshPart(Mesh &mesh, float r, float g, float b);
+
+// Append geometry to the current part
+void meshVertex(Mesh &mesh, const float position[3], const float normal[3], float u = 0, float v = 0);
+void meshQuad(Mesh &mesh, const float a[3], const float b[3], const float c[3], const float d[3], const float normal[3]);
+
+// Mesh versions of the immediate-mode helpers in racing.cpp, with the same tessellation
+void meshBox(Mesh &mesh, float x1, float y1, float z1, float x2, float y2, float z2);
+void meshRing(Mesh &mesh, float cx, float cy, float cz, float innerRadius, float outerRadius,
+              float startAngle, float endAngle, int segments = 50);
+void meshCurvedWall(Mesh &mesh, float cx, float cy, float cz, float innerRadius, float outerRadius,
+                    float startAngle, float endAngle, int segments = 50);
+
+// Upright cylinder or cone from y = 0 to height, with the tessellation, normals and
+// texture coordinates of gluCylinder() turned from +Z to +Y (glRotatef(-90, 1, 0, 0))
+void meshCylinder(Mesh &mesh, float baseRadius, float topRadius, float height, int slices, int stacks);
+
+// Sphere around the origin with its poles on the Z axis, as glutSolidSphere()
+void meshSphere(Mesh &mesh, float radius, int slices, int stacks);
+
+// Torus around the Z axis, as glutSolidTorus(): tube radius, ring radius, tube sides, ring segments
+void meshTorus(Mesh &mesh, float innerRadius, float outerRadius, int sides, int rings);
+
+// Flat disc in the XY plane facing -Z, as drawCircleXY() in racing.cpp
+void meshDisc(Mesh &mesh, float radius, int segments);
+
+// Bicubic Bezier patch from control[v][u] (the layout glMap2f() takes with a v stride of
+// 12), evaluated on a uSegments x vSegments grid. Normals are exact, pointing along
+// dP/dv x dP/du, and texture coordinates run from 0 to textureScale along u and v.
+void meshBezierPatch(Mesh &mesh, const float control[4][4][3], int uSegments, int vSegments, float textureScale = 1);
+
+// Drop the geometry to build it again, keeping the GL copy until the next upload
+// or release. Needs no GL context, so meshes can be rebuilt on another thread.
+void clearMesh(Mesh &mesh);
+
+// Hand the mesh to GL. Needs a current context; re-uploading replaces the old copy.
+void uploadMesh(Mesh &mesh);
+
+// Free the CPU copy of an uploaded mesh. It still draws and counts its vertices,
+// but cannot be uploaded again until it is rebuilt.
+void dropMeshVertices(Mesh &mesh);
+void drawMesh(const Mesh &mesh);
+
+// Draw one mesh many times with different modelview matrices: the buffer is
+// bound once, then each drawMeshInstance() costs only the draw calls
+void beginMeshInstances(const Mesh &mesh);
+void drawMeshInstance(const Mesh &mesh);
+void drawMeshPart(const Mesh &mesh, int part);  // Only one part, also between begin/endMeshInstances()
+// Parts first to first + count - 1 in one draw call, in the first part's colour; meant for runs of one colour
+void drawMeshParts(const Mesh &mesh, int first, int count);
+void endMeshInstances(const Mesh &mesh);
+void releaseMesh(Mesh &mesh);
+
+// True if the context supports vertex buffer objects (GL 1.5)
+bool meshBuffersSupported();
+
+// Draw calls and vertices handed to GL, for benchmarks. Mesh draws count themselves;
+// immediate-mode code reports each glBegin()/glEnd() batch with countDraw().
+struct DrawCounters {
+    long drawCalls = 0, vertices = 0;
+};
+extern DrawCounters drawCounters;
+inline void countDraw(long vertices, long drawCalls = 1) {
+    drawCounters.drawCalls += drawCalls;
+    drawCounters.vertices += vertices;
+}
+
+#endif
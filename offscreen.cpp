@@ -0,0 +1,90 @@
+/******************************************
+*
+* Offscreen rendering context.
+*
+*******************************************/
+
+#include <iostream>
+#include <cstring>
+
+#include "offscreen.h"
+
+#ifdef __APPLE__
+
+bool createOffscreenContext(int width, int height) {
+    std::cerr << "Offscreen rendering needs EGL, which is not available on this platform" << std::endl;
+    return false;
+}
+void destroyOffscreenContext() {
+}
+
+#else
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLContext context = EGL_NO_CONTEXT;
+static EGLSurface surface = EGL_NO_SURFACE;
+
+// Mesa's surfaceless platform needs neither a display server nor a GPU;
+// fall back to the default display where it is missing
+static EGLDisplay openDisplay() {
+    const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (extensions && strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) {
+            EGLDisplay surfaceless = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (surfaceless != EGL_NO_DISPLAY && eglInitialize(surfaceless, nullptr, nullptr)) return surfaceless;
+        }
+    }
+    EGLDisplay fallback = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (fallback != EGL_NO_DISPLAY && eglInitialize(fallback, nullptr, nullptr)) return fallback;
+    return EGL_NO_DISPLAY;
+}
+
+static bool fail(const char *step) {
+    std::cerr << "Offscreen context: " << step << " failed (EGL error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+    destroyOffscreenContext();
+    return false;
+}
+
+bool createOffscreenContext(int width, int height) {
+    display = openDisplay();
+    if (display == EGL_NO_DISPLAY) return fail("eglInitialize");
+
+    // The same buffers the GLUT window asks for: RGB with a depth buffer
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configs = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configs) || configs == 0) return fail("eglChooseConfig");
+    if (!eglBindAPI(EGL_OPENGL_API)) return fail("eglBindAPI");
+
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr); // Compatibility profile
+    if (context == EGL_NO_CONTEXT) return fail("eglCreateContext");
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+    surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    if (surface == EGL_NO_SURFACE) return fail("eglCreatePbufferSurface");
+    if (!eglMakeCurrent(display, surface, surface, context)) return fail("eglMakeCurrent");
+    return true;
+}
+
+void destroyOffscreenContext() {
+    if (display == EGL_NO_DISPLAY) return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+    if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+    eglTerminate(display);
+    display = EGL_NO_DISPLAY;
+    context = EGL_NO_CONTEXT;
+    surface = EGL_NO_SURFACE;
+}
+
+#endif
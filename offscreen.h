@@ -0,0 +1,18 @@
+/******************************************
+*
+* Offscreen rendering context. Creates a GL context with a pbuffer of a
+* given size through EGL, without a window or display, so the renderer
+* can run on machines without a GPU or X server (Mesa's llvmpipe
+* software rasterizer). Used by the render benchmark instead of GLUT.
+*
+*******************************************/
+
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+// Create the context and make it current. On failure prints why and returns false;
+// platforms without EGL always fail.
+bool createOffscreenContext(int width, int height);
+void destroyOffscreenContext();
+
+#endif
@@ -0,0 +1,173 @@
+/******************************************
+*
+* Particle engine kernels.
+*
+*******************************************/
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#include "particles.h"
+#include "simd.h"
+
+int particleSimdWidth() {
+    return SIMD_WIDTH;
+}
+void initParticles(ParticleSystem &system, int maxCount) {
+    system = ParticleSystem();
+    system.maxCount = maxCount;
+}
+// Grow the pool to hold at least needed particles: at least doubling, up to maxCount
+static void reserveParticles(ParticleSystem &system, int needed) {
+    if (needed <= system.allocated) return;
+    int size = std::min(std::max(needed, 2 * system.allocated), system.maxCount);
+    size = (size + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH; // Whole SIMD blocks, so sweeps need no tail loop
+    for (std::vector<float> *array : {&system.x, &system.y, &system.z, &system.vx, &system.vy, &system.vz, &system.age, &system.life}) {
+        array->resize(size);
+    }
+    system.color.resize(size);
+    system.allocated = size;
+}
+size_t particleBytes(const ParticleSystem &system) {
+    return (size_t)system.allocated * (8 * sizeof(float) + sizeof(uint32_t)) + system.dead.capacity() * sizeof(int);
+}
+
+/*\ ---- Emitters ---- \*/
+int addEmitter(ParticleSystem &system, const ParticleEmitter &emitter) {
+    int index;
+    if (!system.freeEmitters.empty()) {
+        index = system.freeEmitters.back();
+        system.freeEmitters.pop_back();
+        system.emitters[index] = emitter;
+    } else {
+        index = (int)system.emitters.size();
+        system.emitters.push_back(emitter);
+    }
+    system.emitters[index].active = true;
+    return index;
+}
+void removeEmitter(ParticleSystem &system, int emitter) {
+    system.emitters[emitter].active = false;
+    system.freeEmitters.push_back(emitter);
+}
+// Uniform in [0, 1)
+static float randomUnit(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state >> 8) * (1.0f / 16777216);
+}
+// Uniform in [-1, 1)
+static float randomSigned(uint32_t &state) {
+    return 2 * randomUnit(state) - 1;
+}
+static uint32_t packColor(float r, float g, float b, float a) {
+    auto channel = [](float c) { return (uint32_t)lround(std::min(std::max(c, 0.0f), 1.0f) * 255); };
+    return channel(r) | channel(g) << 8 | channel(b) << 16 | channel(a) << 24; // Bytes in RGBA order
+}
+int emitParticles(ParticleSystem &system, int emitter, float count) {
+    ParticleEmitter &e = system.emitters[emitter];
+    float total = e.pending + count;
+    int spawned = (int)total;
+    e.pending = total - spawned;
+    spawned = std::min(spawned, system.maxCount - system.count);
+    if (spawned <= 0) return 0;
+    reserveParticles(system, system.count + spawned);
+
+    uint32_t &random = system.random;
+    for (int i = system.count; i < system.count + spawned; i++) {
+        system.x[i] = e.position[0] + randomSigned(random) * e.positionSpread;
+        system.y[i] = e.position[1] + randomSigned(random) * e.positionSpread;
+        system.z[i] = e.position[2] + randomSigned(random) * e.positionSpread;
+        system.vx[i] = e.velocity[0] + randomSigned(random) * e.velocitySpread[0];
+        system.vy[i] = e.velocity[1] + randomSigned(random) * e.velocitySpread[1];
+        system.vz[i] = e.velocity[2] + randomSigned(random) * e.velocitySpread[2];
+        system.age[i] = 0;
+        system.life[i] = e.life + randomSigned(random) * e.lifeSpread;
+        float rgb[3];
+        for (int c = 0; c < 3; c++) rgb[c] = e.color[c] + (randomUnit(random) - e.color[c]) * e.colorSpread;
+        system.color[i] = packColor(rgb[0], rgb[1], rgb[2], e.alpha);
+    }
+    system.count += spawned;
+    return spawned;
+}
+/*\ -------------------------- \*/
+
+/*\ ---- Update ---- \*/
+// Semi-implicit Euler for every particle, a SIMD block at a time. Lanes past
+// count hold stale data; they are integrated but never reported dead.
+static void integrateParticles(ParticleSystem &system, float dt) {
+    float damping = std::max(0.0f, 1 - system.drag * dt);
+    const vf step = vset(dt), damp = vset(damping), fall = vset(system.gravity * dt), floor = vset(system.floor);
+    float *x = system.x.data(), *y = system.y.data(), *z = system.z.data();
+    float *vx = system.vx.data(), *vy = system.vy.data(), *vz = system.vz.data();
+    float *age = system.age.data();
+    const float *life = system.life.data();
+    int32_t lanes[SIMD_WIDTH];
+    system.dead.clear();
+    for (int i = 0; i < system.count; i += SIMD_WIDTH) {
+        vf vxi = vmul(vload(vx + i), damp);
+        vf vyi = vmul(vadd(vload(vy + i), fall), damp);
+        vf vzi = vmul(vload(vz + i), damp);
+        vf yi = vadd(vload(y + i), vmul(vyi, step));
+        vf agei = vadd(vload(age + i), step);
+        vstore(vx + i, vxi);
+        vstore(vy + i, vyi);
+        vstore(vz + i, vzi);
+        vstore(x + i, vadd(vload(x + i), vmul(vxi, step)));
+        vstore(y + i, yi);
+        vstore(z + i, vadd(vload(z + i), vmul(vzi, step)));
+        vstore(age + i, agei);
+
+        vm dies = mor(vge(agei, vload(life + i)), vlt(yi, floor));
+        if (!many(dies)) continue;
+        mstore(lanes, dies);
+        for (int k = 0; k < SIMD_WIDTH && i + k < system.count; k++) {
+            if (lanes[k]) system.dead.push_back(i + k);
+        }
+    }
+}
+// Fill each dead slot with the last live particle. Going from the highest dead
+// index down, the last particle is always live by the time it is moved.
+static void retireParticles(ParticleSystem &system) {
+    for (auto i = system.dead.rbegin(); i != system.dead.rend(); ++i) {
+        int slot = *i, last = --system.count;
+        if (slot == last) continue;
+        system.x[slot] = system.x[last];
+        system.y[slot] = system.y[last];
+        system.z[slot] = system.z[last];
+        system.vx[slot] = system.vx[last];
+        system.vy[slot] = system.vy[last];
+        system.vz[slot] = system.vz[last];
+        system.age[slot] = system.age[last];
+        system.life[slot] = system.life[last];
+        system.color[slot] = system.color[last];
+    }
+}
+void updateParticles(ParticleSystem &system, float dt) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t e = 0; e < system.emitters.size(); e++) {
+        if (system.emitters[e].active && system.emitters[e].rate > 0) emitParticles(system, (int)e, system.emitters[e].rate * dt);
+    }
+    if (dt > 0) {
+        integrateParticles(system, dt);
+        retireParticles(system);
+    }
+    system.updateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+/*\ -------------------------- \*/
+
+void packParticles(const ParticleSystem &system, ParticleVertex *vertices) {
+    for (int i = 0; i < system.count; i++) {
+        ParticleVertex &vertex = vertices[i];
+        vertex.x = system.x[i];
+        vertex.y = system.y[i];
+        vertex.z = system.z[i];
+        vertex.color = system.color[i];
+        if (system.fade) {
+            float left = std::max(0.0f, 1 - system.age[i] / system.life[i]);
+            vertex.color = (vertex.color & 0xffffffu) | (uint32_t)((vertex.color >> 24) * left) << 24;
+        }
+    }
+}
@@ -0,0 +1,83 @@
+/******************************************
+*
+* Particle engine. Each system keeps its particles in structure-of-arrays
+* form in a pool that grows to the largest count seen and is never freed;
+* live particles are packed at the front, so a step is one SIMD sweep and
+* a dead particle is replaced by the last live one. Emitters are pooled
+* slots spawning into their system at a rate or in bursts. All particles
+* of a system share its gravity, drag and floor. No GL/GLUT dependencies.
+*
+*******************************************/
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <vector>
+#include <cstdint>
+
+// Where and how an emitter spawns particles. Units are world units and seconds.
+struct ParticleEmitter {
+    bool active = false;
+    float position[3] = {0, 0, 0};
+    float positionSpread = 0;                                 // Start up to this far from position on each axis
+    float velocity[3] = {0, 0, 0}, velocitySpread[3] = {0, 0, 0};  // Mean start velocity and random +- per axis
+    float color[3] = {1, 1, 1};
+    float colorSpread = 0;                                    // 0 is exactly color, 1 fully random
+    float alpha = 1;
+    float life = 1, lifeSpread = 0;                           // Seconds
+    float rate = 0;                                           // Particles per second while active
+    float pending = 0;                                        // Fraction of a particle carried to the next emission
+};
+
+// Vertex for drawing: position and RGBA colour
+struct ParticleVertex {
+    float x, y, z;
+    uint32_t color;
+};
+
+struct ParticleSystem {
+    int count = 0;        // Live particles, in [0, count)
+    int maxCount = 0;     // Pool limit; emission beyond it is dropped
+    int allocated = 0;    // Pool size so far, a multiple of the SIMD width
+
+    std::vector<float> x, y, z, vx, vy, vz, age, life;
+    std::vector<uint32_t> color;  // RGBA8, alpha at birth
+    std::vector<int> dead;        // Scratch: particles that died this step
+
+    float gravity = 0;            // Acceleration along y, units per second squared
+    float drag = 0;               // Fraction of velocity lost per second
+    float floor = -1e30f;         // Particles below this height die
+    bool fade = false;            // Alpha falls to zero over each particle's life
+
+    std::vector<ParticleEmitter> emitters;
+    std::vector<int> freeEmitters;
+    uint32_t random = 2463534242u;  // xorshift state, so emission does not disturb rand()
+
+    double updateMilliseconds = 0;  // Time of the last updateParticles()
+};
+
+// Empty system holding up to maxCount particles
+void initParticles(ParticleSystem &system, int maxCount);
+
+// Take an emitter slot (a freed one if there is one) and return its index
+int addEmitter(ParticleSystem &system, const ParticleEmitter &emitter);
+void removeEmitter(ParticleSystem &system, int emitter);
+
+// Spawn count particles from an emitter now; a fractional part is carried over.
+// Returns the number spawned.
+int emitParticles(ParticleSystem &system, int emitter, float count);
+
+// Spawn from active emitters by rate, then advance every particle by dt
+// seconds and retire those past their life or below the floor
+void updateParticles(ParticleSystem &system, float dt);
+
+// Write the live particles as vertices (count of them), fading alpha if the system does
+void packParticles(const ParticleSystem &system, ParticleVertex *vertices);
+
+// Bytes held by the pool
+size_t particleBytes(const ParticleSystem &system);
+
+// Lanes processed per SIMD instruction in this build
+int particleSimdWidth();
+
+#endif
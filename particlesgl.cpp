@@ -0,0 +1,117 @@
+/******************************************
+*
+* Particle drawing.
+*
+*******************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#ifdef __APPLE__
+#  include <GLUT/glut.h>
+#else
+#  define GL_GLEXT_PROTOTYPES
+#  include <GL/glut.h>
+#endif
+
+#include "particlesgl.h"
+#include "mesh.h"
+#include "texture.h"
+
+#define SPRITE_SIZE 32  // Sprite texture size, in texels
+
+// Point sprites and point parameters are core from GL 2.0
+static bool pointSpritesSupported() {
+    static int supported = -1;
+    if (supported < 0) {
+        const char *version = (const char *)glGetString(GL_VERSION);
+        int major = 0;
+        supported = version && sscanf(version, "%d", &major) == 1 && major >= 2;
+    }
+    return supported;
+}
+// A disc fading to transparent at its edge, as an alpha texture
+static unsigned int buildSprite() {
+    Image image;
+    initImage(image, SPRITE_SIZE, SPRITE_SIZE, 1);
+    for (int row = 0; row < SPRITE_SIZE; row++) {
+        for (int col = 0; col < SPRITE_SIZE; col++) {
+            float dx = (col + 0.5f) / SPRITE_SIZE * 2 - 1, dy = (row + 0.5f) / SPRITE_SIZE * 2 - 1;
+            float alpha = std::max(0.0f, 1 - (dx * dx + dy * dy));
+            image.pixels[row * SPRITE_SIZE + col] = (unsigned char)lround(std::min(1.0f, 2 * alpha) * 255);
+        }
+    }
+    buildMipChain(image);
+    return cacheTexture("particle sprite", image, false);
+}
+void drawParticles(ParticleRenderer &renderer, const ParticleSystem &system, float pointSize, float referenceDistance) {
+    if (system.count == 0) return;
+    const GLsizei stride = sizeof(ParticleVertex);
+    size_t bytes = (size_t)system.count * stride;
+    const char *base = nullptr;
+    if (meshBuffersSupported()) {
+        if (!renderer.buffer) glGenBuffers(1, &renderer.buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, renderer.buffer);
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW); // Orphan last frame's storage
+        void *mapped = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+        if (!mapped) {
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            return;
+        }
+        packParticles(system, (ParticleVertex *)mapped);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    } else {
+        renderer.vertices.resize(system.count);
+        packParticles(system, renderer.vertices.data());
+        base = (const char *)renderer.vertices.data();
+    }
+
+    bool sprites = pointSpritesSupported();
+    if (sprites) {
+        if (!renderer.sprite) renderer.sprite = buildSprite();
+        float attenuation[3] = {0, 0, 1 / (referenceDistance * referenceDistance)}; // pointSize * referenceDistance / distance
+        glPointParameterfv(GL_POINT_DISTANCE_ATTENUATION, attenuation);
+        glPointParameterf(GL_POINT_SIZE_MIN, 1);
+        glPointParameterf(GL_POINT_SIZE_MAX, 4 * pointSize);
+        glEnable(GL_POINT_SPRITE);
+        glTexEnvi(GL_POINT_SPRITE, GL_COORD_REPLACE, GL_TRUE);
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, renderer.sprite);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    }
+    glPointSize(pointSize);
+    glDisable(GL_LIGHTING);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE); // Particles are depth tested but do not hide each other
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, base);
+    glColorPointer(4, GL_UNSIGNED_BYTE, stride, base + 3 * sizeof(float));
+    glDrawArrays(GL_POINTS, 0, system.count);
+    countDraw(system.count);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    if (renderer.buffer) glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    glEnable(GL_LIGHTING);
+    glPointSize(1);
+    if (sprites) {
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDisable(GL_TEXTURE_2D);
+        glTexEnvi(GL_POINT_SPRITE, GL_COORD_REPLACE, GL_FALSE);
+        glDisable(GL_POINT_SPRITE);
+        float constant[3] = {1, 0, 0};
+        glPointParameterfv(GL_POINT_DISTANCE_ATTENUATION, constant);
+    }
+}
+void releaseParticleRenderer(ParticleRenderer &renderer) {
+    if (renderer.buffer) glDeleteBuffers(1, &renderer.buffer);
+    renderer.buffer = 0;
+    renderer.sprite = 0;
+    renderer.vertices = std::vector<ParticleVertex>();
+}
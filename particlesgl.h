@@ -0,0 +1,31 @@
+/******************************************
+*
+* Particle drawing. Every frame the live particles are packed straight
+* into a vertex buffer (orphaned, so the driver never waits on the last
+* frame's copy, and mapped for writing) and drawn with one call as
+* textured point sprites that shrink with distance. Where buffers are
+* unavailable a client-side array is used; without sprites, plain points.
+*
+*******************************************/
+
+#ifndef PARTICLESGL_H
+#define PARTICLESGL_H
+
+#include <vector>
+
+#include "particles.h"
+
+struct ParticleRenderer {
+    unsigned int buffer = 0;  // Streamed vertex buffer, if available
+    unsigned int sprite = 0;  // Soft round sprite, from the texture cache
+    std::vector<ParticleVertex> vertices;  // Client-side array otherwise
+};
+
+// Draw a system's live particles, pointSize pixels across at referenceDistance
+// from the eye. Blended, without writing depth. Needs a current context.
+void drawParticles(ParticleRenderer &renderer, const ParticleSystem &system, float pointSize, float referenceDistance = 200);
+
+// Delete the buffer; call with releaseTextures(), which frees the sprite
+void releaseParticleRenderer(ParticleRenderer &renderer);
+
+#endif
@@ -0,0 +1,163 @@
+/******************************************
+*
+* Frame profiler.
+*
+*******************************************/
+
+#include <atomic>
+#include <mutex>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "profile.h"
+
+bool profilingEnabled = false;
+
+static std::mutex sectionMutex;  // Only taken when a section is registered
+static char sectionNames[PROFILE_MAX_SECTIONS][32];
+static std::atomic<int> sectionCount(0);
+
+// Totals of the frame in progress per channel (0 = CPU, 1 = GPU), in nanoseconds
+static std::atomic<long long> frameNanos[2][PROFILE_MAX_SECTIONS];
+static std::atomic<int> frameHits[2][PROFILE_MAX_SECTIONS];
+
+// Ring buffer of closed frames, written only by endProfileFrame(). Readers take
+// framesWritten (acquire) and read the rows before it without locking.
+struct ProfileFrame {
+    float milliseconds[2][PROFILE_MAX_SECTIONS];  // NAN where the section did not run
+};
+static ProfileFrame history[PROFILE_HISTORY];
+static std::atomic<long> framesWritten(0);
+
+int profileSection(const char *name) {
+    std::lock_guard<std::mutex> lock(sectionMutex);
+    int count = sectionCount.load();
+    for (int s = 0; s < count; ++s) {
+        if (strcmp(sectionNames[s], name) == 0) return s;
+    }
+    if (count == PROFILE_MAX_SECTIONS) return PROFILE_MAX_SECTIONS - 1; // Full: share the last one
+    snprintf(sectionNames[count], sizeof(sectionNames[count]), "%s", name);
+    sectionCount.store(count + 1);
+    return count;
+}
+int profileSectionCount() {
+    return sectionCount.load();
+}
+const char *profileSectionName(int section) {
+    return sectionNames[section];
+}
+
+void addProfileTime(int section, double milliseconds, bool gpu) {
+    frameNanos[gpu][section].fetch_add(llround(milliseconds * 1e6), std::memory_order_relaxed);
+    frameHits[gpu][section].fetch_add(1, std::memory_order_relaxed);
+}
+
+void endProfileFrame() {
+    long frame = framesWritten.load(std::memory_order_relaxed);
+    ProfileFrame &row = history[frame % PROFILE_HISTORY];
+    for (int channel = 0; channel < 2; ++channel) {
+        for (int s = 0; s < PROFILE_MAX_SECTIONS; ++s) {
+            int hits = frameHits[channel][s].exchange(0, std::memory_order_relaxed);
+            long long nanos = frameNanos[channel][s].exchange(0, std::memory_order_relaxed);
+            row.milliseconds[channel][s] = hits ? nanos * 1e-6f : NAN;
+        }
+    }
+    framesWritten.store(frame + 1, std::memory_order_release);
+}
+long profileFrameCount() {
+    return framesWritten.load(std::memory_order_acquire);
+}
+
+// Frame numbers held in the ring buffer: [first, end)
+static void historyRange(long &first, long &end) {
+    end = framesWritten.load(std::memory_order_acquire);
+    first = std::max(0L, end - PROFILE_HISTORY);
+}
+
+ProfileStats profileStats(int section, bool gpu) {
+    ProfileStats stats;
+    long first, end;
+    historyRange(first, end);
+    std::vector<float> samples;
+    samples.reserve(end - first);
+    for (long frame = first; frame < end; ++frame) {
+        float milliseconds = history[frame % PROFILE_HISTORY].milliseconds[gpu][section];
+        if (std::isnan(milliseconds)) continue;
+        samples.push_back(milliseconds);
+        stats.last = milliseconds;
+        stats.mean += milliseconds;
+    }
+    stats.samples = (long)samples.size();
+    if (samples.empty()) return stats;
+
+    // Nearest-rank percentiles
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) {
+        size_t rank = (size_t)ceil(p * samples.size());
+        return samples[std::max<size_t>(rank, 1) - 1];
+    };
+    stats.mean /= samples.size();
+    stats.p50 = percentile(0.50);
+    stats.p99 = percentile(0.99);
+    stats.max = samples.back();
+    return stats;
+}
+
+bool writeProfileCsv(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) return false;
+
+    int count = profileSectionCount();
+    bool gpu[PROFILE_MAX_SECTIONS];
+    fprintf(file, "frame");
+    for (int s = 0; s < count; ++s) {
+        gpu[s] = profileStats(s, true).samples > 0;
+        fprintf(file, ",%s cpu ms", sectionNames[s]);
+        if (gpu[s]) fprintf(file, ",%s gpu ms", sectionNames[s]);
+    }
+    fprintf(file, "\n");
+
+    long first, end;
+    historyRange(first, end);
+    for (long frame = first; frame < end; ++frame) {
+        const ProfileFrame &row = history[frame % PROFILE_HISTORY];
+        fprintf(file, "%ld", frame);
+        for (int s = 0; s < count; ++s) {
+            for (int channel = 0; channel <= (int)gpu[s]; ++channel) {
+                float milliseconds = row.milliseconds[channel][s];
+                if (std::isnan(milliseconds)) fprintf(file, ",");
+                else fprintf(file, ",%.4f", milliseconds);
+            }
+        }
+        fprintf(file, "\n");
+    }
+    return fclose(file) == 0;
+}
+
+static void writeJsonStats(FILE *file, const ProfileStats &stats) {
+    fprintf(file, "{\"samples\": %ld, \"last\": %.4f, \"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+            stats.samples, stats.last, stats.mean, stats.p50, stats.p99, stats.max);
+}
+bool writeProfileJson(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) return false;
+
+    long first, end;
+    historyRange(first, end);
+    fprintf(file, "{\n  \"frames\": %ld,\n  \"sections\": [\n", end - first);
+    int count = profileSectionCount();
+    for (int s = 0; s < count; ++s) {
+        ProfileStats gpu = profileStats(s, true);
+        fprintf(file, "    {\"name\": \"%s\", \"cpu\": ", sectionNames[s]);
+        writeJsonStats(file, profileStats(s, false));
+        fprintf(file, ", \"gpu\": ");
+        if (gpu.samples) writeJsonStats(file, gpu);
+        else fprintf(file, "null");
+        fprintf(file, "}%s\n", s + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0;
+}
@@ -0,0 +1,66 @@
+/******************************************
+*
+* Frame profiler. Scoped timers add the time spent in named sections to
+* the current frame; endProfileFrame() moves the frame's totals into a
+* fixed-size ring buffer of recent frames, from which per-section
+* percentiles and CSV/JSON reports are computed. No GL/GLUT dependencies;
+* GPU times are fed in by profilegl.cpp.
+*
+*******************************************/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <chrono>
+
+#define PROFILE_MAX_SECTIONS 32
+#define PROFILE_HISTORY 1024  // Frames kept in the ring buffer
+
+// Off by default so the headless core pays only a branch per scope
+extern bool profilingEnabled;
+
+// Id of a named section, registered on first use (thread-safe)
+int profileSection(const char *name);
+int profileSectionCount();
+const char *profileSectionName(int section);
+
+// Add time to a section in the current frame. Safe from any thread.
+void addProfileTime(int section, double milliseconds, bool gpu = false);
+
+// Times the enclosing scope into a section
+struct ProfileScope {
+    int section;
+    std::chrono::steady_clock::time_point start;
+    explicit ProfileScope(int section) : section(section) {
+        if (profilingEnabled) start = std::chrono::steady_clock::now();
+    }
+    ~ProfileScope() {
+        if (profilingEnabled) {
+            addProfileTime(section, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(name) \
+    static const int PROFILE_CONCAT(profileSectionId, __LINE__) = profileSection(name); \
+    ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileSectionId, __LINE__))
+
+// Close the current frame: each section's total goes into the ring buffer
+// (or "did not run" if it was never entered) and the totals restart at zero
+void endProfileFrame();
+long profileFrameCount();
+
+// Statistics over the frames in the ring buffer where the section ran
+struct ProfileStats {
+    long samples = 0;
+    double last = 0, mean = 0, p50 = 0, p99 = 0, max = 0;  // Milliseconds
+};
+ProfileStats profileStats(int section, bool gpu = false);
+
+// Reports: one row per frame in the ring buffer, or per-section summaries
+bool writeProfileCsv(const char *path);
+bool writeProfileJson(const char *path);
+
+#endif
@@ -0,0 +1,93 @@
+/******************************************
+*
+* GPU side of the frame profiler.
+*
+*******************************************/
+
+#include <cstring>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+#ifdef __APPLE__
+#  include <GLUT/glut.h>
+#else
+#  define GL_GLEXT_PROTOTYPES
+#  include <GL/glut.h>
+#endif
+
+#include "profilegl.h"
+
+#define GPU_PROFILE_MAX_PENDING 4096  // Query pairs in flight before new scopes are skipped
+
+struct PendingQuery {
+    int section;
+    GLuint queries[2];
+};
+static std::deque<PendingQuery> pending;  // In submission order, so they complete in order
+static std::vector<GLuint> freeQueries;
+
+bool gpuProfilingSupported() {
+#ifdef __APPLE__
+    return false; // The legacy GL 2.1 context has no timestamp queries
+#else
+    static int supported = -1;
+    if (supported < 0) {
+        const char *version = (const char *)glGetString(GL_VERSION);
+        const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+        int major = 0, minor = 0;
+        if (version) sscanf(version, "%d.%d", &major, &minor);
+        supported = major > 3 || (major == 3 && minor >= 3) || (extensions && strstr(extensions, "GL_ARB_timer_query"));
+    }
+    return supported;
+#endif
+}
+
+#ifndef __APPLE__
+static GLuint takeQuery() {
+    if (freeQueries.empty()) {
+        GLuint names[64];
+        glGenQueries(64, names);
+        freeQueries.insert(freeQueries.end(), names, names + 64);
+    }
+    GLuint query = freeQueries.back();
+    freeQueries.pop_back();
+    return query;
+}
+#endif
+
+GpuProfileScope::GpuProfileScope(int section) : section(section) {
+#ifndef __APPLE__
+    if (!profilingEnabled || pending.size() >= GPU_PROFILE_MAX_PENDING || !gpuProfilingSupported()) return;
+    queries[0] = takeQuery();
+    queries[1] = takeQuery();
+    glQueryCounter(queries[0], GL_TIMESTAMP);
+#endif
+}
+GpuProfileScope::~GpuProfileScope() {
+#ifndef __APPLE__
+    if (!queries[0]) return;
+    glQueryCounter(queries[1], GL_TIMESTAMP);
+    PendingQuery query = {section, {queries[0], queries[1]}};
+    pending.push_back(query);
+#endif
+}
+
+void collectGpuProfile() {
+#ifndef __APPLE__
+    while (!pending.empty()) {
+        PendingQuery &query = pending.front();
+        GLint available = 0;
+        glGetQueryObjectiv(query.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(query.queries[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(query.queries[1], GL_QUERY_RESULT, &end);
+        addProfileTime(query.section, (end - begin) * 1e-6, true);
+        freeQueries.push_back(query.queries[0]);
+        freeQueries.push_back(query.queries[1]);
+        pending.pop_front();
+    }
+#endif
+}
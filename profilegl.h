@@ -0,0 +1,34 @@
+/******************************************
+*
+* GPU side of the frame profiler. Timestamp queries bracket a section's
+* GL commands; their results are collected a few frames later, once the
+* GPU has finished them, so reading them never stalls the pipeline.
+* Needs GL 3.3 or ARB_timer_query, otherwise only CPU times are recorded.
+*
+*******************************************/
+
+#ifndef PROFILEGL_H
+#define PROFILEGL_H
+
+#include "profile.h"
+
+// True if the current context has timestamp queries
+bool gpuProfilingSupported();
+
+// Brackets the enclosing scope's GL commands with timestamp queries
+struct GpuProfileScope {
+    int section;
+    unsigned int queries[2] = {0, 0};
+    explicit GpuProfileScope(int section);
+    ~GpuProfileScope();
+};
+
+// CPU and GPU time of the enclosing scope
+#define PROFILE_GL_SCOPE(name) \
+    PROFILE_SCOPE(name); \
+    GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(PROFILE_CONCAT(profileSectionId, __LINE__))
+
+// Add the GPU times of every finished query to the current frame. Call once per frame.
+void collectGpuProfile();
+
+#endif
@@ -18,6 +18,10 @@
 *  X: Toggle between first-person view (FPV) and third-person view.
 * Miscellaneous Controls
 *  H: Cycle through different headlight modes: Auto, Off, Low, High
+*  L: Show level-of-detail, culling, texture and particle counters (objects, triangles and triangles saved per level; visible and culled objects; resident texture memory; live particles, update time and memory per effect)
+*  F: Toggle view-frustum culling (counts are shown with L)
+*  P: Show the frame profiler (p50/p99 CPU and GPU milliseconds per section; saved on exit with --profile)
+*  G: Toggle the ghost cars (the best lap, saved next to the track file, and any laps loaded with --ghost)
 * Stepping Controls (stepping through walls)
 *  Arrow Up: Move forward relative to the vehicle’s current direction.
 *  Arrow Down: Move backward relative to the vehicle’s current direction.
@@ -26,15 +30,31 @@
 * Mouse Controls
 *  Left click start window to select options and start game.
 *  Right click gameplay window to use popup menu and change day/night.
+* Command Line
+*  --bench [frames [width height]]: Render offscreen along a scripted path and report frame rate, draw calls and vertices.
+*  --profile [path]: On exit, save the frame profile to path.csv (one row per frame) and path.json (percentiles); path is profile by default.
+*  --record file: Log every tick's inputs to file, for headless --replay.
+*  --tick-rate hz: Simulation ticks per second (240 by default); frames are drawn between the last two ticks.
+*  --ghost file: Also race against the lap saved in file (a copy of an earlier best lap); may be repeated.
+*  --track file: Race on another track file (binary or text) instead of tracks/default.track.
+*  --track-bench [maxPieces]: Generate tracks of growing size and report collision build and query cost, mesh build time and memory.
+*  --clouds n: Clouds in the sky (6 by default); the benchmark reports their cost per frame.
+*  --confetti n: Confetti particles fired from each cannon when a lap is completed (1000 by default).
+*  --particle-bench [count]: Keep count particles alive (1048576 by default) and report update and draw time per frame.
 *
 *******************************************/
 
 #include <iostream>
 #include <stdio.h>
 #include <iostream>
-#include <fstream>
 #include <cmath>
+#include <cstring>
 #include <map>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <atomic>
 
 #ifdef __APPLE__
 #  include <GLUT/glut.h>
@@ -42,8 +62,36 @@
 #  include <GL/glut.h>
 #endif
 
-#define PI 3.14159
-#define MAX_CONFETTI 100  // Number of confetti particles
+#include "simulation.h"
+#include "distancefield.h"
+#include "track.h"
+#include "mesh.h"
+#include "lod.h"
+#include "cull.h"
+#include "text.h"
+#include "profilegl.h"
+#include "offscreen.h"
+#include "replay.h"
+#include "ghost.h"
+#include "texture.h"
+#include "assets.h"
+#include "barriergrid.h"
+#include "trackgen.h"
+#include "handoff.h"
+#include "particles.h"
+#include "particlesgl.h"
+
+#define MAX_PARTICLES (1 << 20)  // Live particles per effect
+#define CLOUD_VIEWS 16  // Impostor views around the vertical axis
+#define CLOUD_VIEW_SIZE 128  // Impostor texture size per view, in texels
+#define MAX_GHOSTS 16  // The best lap plus laps loaded with --ghost
+#define MAX_NIGHT_FLOOR_QUADS 256  // Past this many floor quads the night floor is not subdivided (about 15 tile draws each)
+#define ASSET_UPLOAD_BUDGET 4  // Milliseconds per frame spent handing loaded assets to GL
+#define GRASS_TEXTURE_PATH "textures/smallgrass.bmp"
+#define TICK_RATE 240  // Default simulation ticks per second, independent of the frame rate
+#define MAX_TICK_BACKLOG 0.25  // Seconds the simulation may fall behind real time before it skips ahead
+#define INPUT_QUEUE_SIZE 256  // Key changes and discrete inputs in flight to the simulation thread
+#define BURST_QUEUE_SIZE 1024  // Particle effects in flight from the simulation thread
 using namespace std;
 
 /*\ ---- Global Variables ---- \*/
@@ -51,15 +99,42 @@ using namespace std;
 // Gameplay mechanics and vehicle dynamics
 bool gameStarted = false;
 float cameraAngle = 0.0f; // Angle for the circular camera motion
-static float meX = 240, meY = 0, meZ = -40;
-float velocity = 0.0, acceleration = 0.05, deceleration = 0.02, maxVelocity = 3.0;
-static float angleX = 0, angleY = -1;
-float turnSpeed = 3.0, wheelAngle = 0;
-static float stepsize = 5.0, turnsize = 10.0;  // Navigation clipping
-int currentCheckpoint = 0;
-bool timerRunning = false;
+SimState sim;  // Car position, heading, velocity and lap state (see simulation.h)
+SimState previousSim;  // The state before the last tick
+SimState drawnSim;  // What this frame draws: interpolated between the last two published ticks
+float tickSeconds = 1.0f / TICK_RATE;  // Fixed simulation step, set with --tick-rate
+static float angleY = -1;
+InputSettings inputSettings;  // Arrow-key navigation: step and turn sizes, clipping through walls
+float fieldCellSize = 1.0;  // Resolution of the baked collision distance field, in world units
+Mesh trackFloorMesh, trackMesh;  // Track geometry, built once in setup(), one part per piece for culling
+LodMesh trunkLod, foliageLod;  // Shared by every tree instance
+bool cloudImpostors = true;  // Draw clouds as camera-facing textured quads instead of spheres
+int cloudCount = 6;  // Clouds in the sky, set with --clouds; extra ones beyond the fixed six are placed randomly
+GLuint cloudImpostorTexture = 0;  // Cloud silhouettes seen from CLOUD_VIEWS directions, side by side
+Image cloudImpostorImage, grassImage;  // Decoded on an asset worker, freed once uploaded
+bool sceneLoaded = false;  // Every scene asset is uploaded; until then the main window shows a loading frame
+bool startWhenLoaded = false;  // Start Game was clicked while loading
+bool firstFrameShown = false;
+auto programStart = std::chrono::steady_clock::now();  // For time to first frame
+LodMesh driverLod, tireLod, discLod, axleLod, cloudPartLod, sunLod, moonLod;  // Level-of-detail primitives
+LodMesh hillLod;  // Bezier hill patch, tessellated once per level
+int hillSegments = 20;  // Hill grid size per side at full detail; lower levels scale it by lodDetail
+bool showLodStats = false;  // Toggled with 'l'
+InputRecording inputRecording;  // Inputs logged with --record
+const char *recordingPath = nullptr;
+GhostRecorder ghostRecorder;  // Pose on every tick of the lap being driven
+Ghost ghosts[MAX_GHOSTS];  // Mapped ghost laps; ghosts[0] is the best lap
+int ghostCount = 1;
+std::string bestLapPath;  // The track file with a .ghost extension
+bool showGhosts = true;  // Toggled with 'g'
+bool offscreen = false;  // Render benchmark: no GLUT windows, timers or fonts
+bool showProfile = false;  // Frame profiler overlay, toggled with 'p'
+std::string profilePath;  // Set with --profile: the frame profile is saved to profilePath.csv and .json on exit
+Mesh nightFloorMesh;  // Shared grids of 2x2 cells for headlight pools, one fine and one coarse part per tile size
+float nightDetailRadius = 150;  // Night floor tiles farther than this from the car drop to one quad; 0 keeps all fine
+int randomTreeCount = 50;  // Trees scattered outside the track, on top of the fixed ones
+TextAtlas hudText, startScreenText;  // Font atlases of the main and start windows, built on their first frame
 float currentLapTime = 0;
-int lapStartTime = 0, lapEndTime = 0;
 
 // Environment settings
 int mainWindow, startWindow;
@@ -82,13 +157,9 @@ unsigned long lastUpdateTime = 0;  // Last update timestamp
 bool isDaySelected = true;
 bool isNightSelected = false;
 static float teapotRotationAngle = 0.0f; // For rotating objects like teapots
-GLuint textureGrass[1];
-struct BitMapFile {
-    int sizeX;
-    int sizeY;
-    unsigned char *data;
-};
+GLuint textureGrass = 0;
 float cloudSpeed = 0.05;
+float cloudDrift = 0;  // How far the clouds have blown along z, in [0, 50)
 struct CloudPosition {
     float x, y, z;
 };
@@ -100,77 +171,62 @@ struct Tree {
     Tree(float x, float y, float z, float trunkHeight, float treeHeight)
         : x(x), y(y), z(z), trunkHeight(trunkHeight), treeHeight(treeHeight) {}
 };
-struct ConfettiParticle {
-    float position[3];
-    float velocity[3];
-    float color[3];
-    bool active;
+struct FloorTile {
+    float x, z, radius;  // Bounding circle on the ground
+    float min[3], max[3];  // Bounding box
+    float transform[16];  // Column-major: the grid's cell (u, v) to the floor, y along the quad's normal
+    int part;  // Fine part of the grid of this tile's size in nightFloorMesh; part + 1 is coarse
+};
+ParticleSystem confetti, smoke, sparks;  // Lap celebrations, tyre smoke, barrier sparks
+ParticleRenderer particleRenderer;
+int confettiCannons[2], smokeEmitter, sparkEmitter;
+int confettiPerCannon = 1000;  // Set with --confetti
+long particleTicks = 0;  // Simulation ticks the particles have moved through
+
+// Once the scene is loaded, sim, previousSim, the cloud drift and the teapot and
+// camera angles belong to the simulation thread. After every tick it publishes a copy;
+// frames draw the newest copy and never wait.
+struct SimSnapshot {
+    SimState previous, current;  // The last two ticks
+    double tickTime = 0;  // Seconds since start at which current was due
+    long ticks = 0;  // Ticks run so far
+    float cloudDrift = 0;  // Clouds are drawn from cloudPositions, moved on by this
+    float teapotAngle = 0, cameraAngle = 0;
+    int lapsCompleted = 0;  // The start lights go out when this changes
+    int bestLapsSaved = 0;  // The best lap file is mapped again when this changes
+};
+// A held key change or discrete input on its way to the simulation thread
+struct InputMessage {
+    double time;  // Seconds since start; applied before the first tick due at or after it
+    int heldFlags;  // SIM_INPUT_* keys held from then on
+    int event;  // INPUT_* event, or 0 for none
+};
+// Particles the simulation thread asks for; the render thread spawns and moves them
+enum ParticleEffect { CONFETTI_EFFECT, SMOKE_EFFECT, SPARK_EFFECT };
+struct ParticleBurst {
+    int effect;
+    float x, z, heading;  // Car pose
+    float amount;  // Particles, fractions carried over
 };
-ConfettiParticle confettiCannon1[MAX_CONFETTI];
-ConfettiParticle confettiCannon2[MAX_CONFETTI];
+TripleBuffer<SimSnapshot> simSnapshots;
+const SimSnapshot *shown = &simSnapshots.readSlot();  // The snapshot this frame draws
+SpscQueue<InputMessage, INPUT_QUEUE_SIZE> inputQueue;
+SpscQueue<ParticleBurst, BURST_QUEUE_SIZE> burstQueue;
+std::thread simulationThread;
+std::atomic<bool> simulationRunning(false);
+SimInputs heldInputs;  // The held keys as the simulation thread has received them
+double bestLapSeconds = INFINITY;  // Of the best lap file, kept by the simulation thread
+long ticksRun = 0;
+int lapsCompleted = 0, bestLapsSaved = 0;  // Counted by the simulation thread
+int lapsShown = 0, bestLapsMapped = 0;  // The counts the renderer has acted on
+
+std::vector<Tree> trees;  // From the track file
+std::vector<Tree> randomTrees;
+std::vector<FloorTile> nightFloorTiles;
 
 /*\ -------------------------- \*/
 
 /*\ --- Coordinate Arrays ---- \*/
-int axisBarriersCount = 18;
-float axisBarriers[][6] = { // Track along-axis barrier coordinates
-    {-75, 0, -320, -200, 2.5, -325},
-    {-80, 0, -112.5, -75, 2.5, -320},
-    {-200, 0, -325, -205, 2.5, 200},
-    {-205, 0, 200, -40, 2.5, 205},
-    {-205, 0, 275, -35, 2.5, 280},
-    {-275, 0, 200, -280, 2.5, -395},
-    {2.5, 0, -55, -2.5, 2.5, -395},
-    {80, 0, -112.5, 75, 2.5, -317.5},
-    {125, 0, 200, 120, 2.5, 280},
-    {160, 0, -235, 200, 2.5, -240},
-    {160, 0, -240, 240, 2.5, -245},
-    {160, 0, -160, 205, 2.5, -165},
-    {200, 0, 195, 195, 2.5, 280},
-    {200, 0, -160, 205, 2.5, 125},
-    {280, 0, -160, 275, 2.5, 120},
-    {240, 0, -400, -280, 2.5, -395},
-    {240, 0, -322.5, 75, 2.5, -317.5},
-    {240, 0, -322.5, 75, 2.5, -317.5},
-};
-int curveBarriersCount = 13;
-float curveBarriers[][7] = { // Track curved barrier coordinates
-    {80, 2.5, 280, 120, 115, 0, PI},
-    {80, 2.5, 280, 45, 40, 0, PI},
-    {-40, 2.5, 280, 80, 75, 3 * PI / 2, 2 * PI},
-    {-200, 2.5, 200, 80, 75, PI / 2, PI},
-    {240, 2.5, -320, 80, 75, 3 * PI / 2, 5 * PI / 2},
-    {160, 2.5, -240, 80, 75, PI / 2, PI},
-    {200, 2.5, -160, 80, 75, 3 * PI / 2, 2 * PI},
-    {0, 2.5, 0, 140, 135, 1.6875 * PI, 3.3125 * PI},
-    {0, 2.5, 0, 60, 55, 1.5125 * PI, 3.4875 * PI},
-    {200, 2.5, 120, 80, 75, 0, PI / 2},
-    {200, 2.5, 200, 80, 75, PI, 3 * PI / 2},
-    {80, 2.5, -240, 5, 0, 3 * PI / 2, 2 * PI},
-    {160, 2.5, -240, 5, 0, PI / 2, 3 * PI / 2},
-};
-float trackQuads[][5][3] = { // Track quad coordinates
-    {{280, 0, -160}, {280, 0, 120}, {200, 0, 120}, {200, 0, -160}, {0, 1, 0}},
-    {{200, 0, 200}, {200, 0, 280}, {120, 0, 280}, {120, 0, 200}, {0, 1, 0}},
-    {{280, 0, -160}, {280, 0, 120}, {200, 0, 120}, {200, 0, -160}, {0, 1, 0}},
-    {{-40, 0, 200}, {-40, 0, 280}, {-200, 0, 280}, {-200, 0, 200}, {0, 1, 0}},
-    {{-200, 0, 200}, {-280, 0, 200}, {-280, 0, -400}, {-200, 0, -400}, {0, 1, 0}},
-    {{-80, 0, -400}, {-80, 0, -320}, {-200, 0, -320}, {-200, 0, -400}, {0, 1, 0}},
-    {{240, 0, -400}, {240, 0, -240}, {-80, 0, -240}, {-80, 0, -400}, {0, 1, 0}},
-    {{200, 0, -240}, {200, 0, -160}, {160, 0, -160}, {160, 0, -240}, {0, 1, 0}},
-    {{-80, 0, -240}, {-80, 0, -120}, {80, 0, -120}, {80, 0, -240}, {0, 1, 0}},
-};
-float trackCurves[][7] = { // Track curve coordinates
-    {80, 0, 280, 120, 40, 0, PI},
-    {-40, 0, 280, 80, 0, 3 * PI / 2, 2 * PI},
-    {-200, 0, 200, 80, 0, PI / 2, PI},
-    {240, 0, -320, 80, 0, 3 * PI / 2, 5 * PI / 2},
-    {160, 0, -240, 80, 0, PI / 2, PI},
-    {200, 0, -160, 80, 0, 3 * PI / 2, 2 * PI},
-    {0, 0, 0, 140, 60, 0, 2 * PI},
-    {200, 0, 120, 80, 0, 0, PI / 2},
-    {200, 0, 200, 80, 0, PI, 3 * PI / 2},
-};
 float slantedQuads[][5][3] = { // Racecar quads coordinates
     {{-5, 5, 45}, {5, 5, 45}, {5, 10, 15}, {-5, 10, 15}, {0, 1, 0.25}}, // Front wing support
     {{-5, 15, -15}, {5, 15, -15}, {5, 10, -25}, {-5, 10, -25}, {0, 1, -0.5}}, // Behind cockpit slant
@@ -191,7 +247,7 @@ float slantedTriangles[][4][3] = { // Racecar triangles coordinates
     {{-5, 5, 45}, {-5, 5, 15}, {-5, 10, 15}, {-1, 0, 0}}, // Front wing support left
     {{5, 5, 45}, {5, 5, 15}, {5, 10, 15}, {1, 0, 0}}, // Front wing support right
 };
-CloudPosition cloudPositions[] = {
+std::vector<CloudPosition> cloudPositions = { // Before drifting; fixed once the scene is set up
     {5.0, 5.0, 10.0},
     {-15.0, 7.0, 5.0},
     {10.0, 6.0, -10.0},
@@ -209,21 +265,6 @@ CloudPart cloudParts[] = {
     {0.6, 0.0, -0.9, 0.25}, // Back right sphere
     {-0.6, 0.0, -0.9, 0.3} // Back left sphere
 };
-std::vector<Tree> trees = {
-    {253, 0, 196, 5.6, 10.3},
-    {230, 0, 326, 6.7, 9.5},
-    {174, 0, 87, 7.3, 12.3},
-    {160, 0, 120, 6.2, 10.7},
-    {156, 0, -50, 7.1, 12.6},
-    {80, 0, 280, 8.4, 12.5},
-    {10, 0, 180, 9.5, 14.3},
-    {-90, 8, 360, 5.6, 13.1},
-    {-140, 0, 310, 7, 12},
-    {-160, 0, 160, 5.6, 13.1},
-    {-150, 0, 36, 7.2, 12.2},
-    {-185, 0, -86, 7.1, 12.5},
-    {-150, 0, -175, 7.8, 12.3}
-};
 GLfloat hillPoints[4][4][3] = {
     {{-1.5, 0.0, -1.5}, {-0.5, 0.0, -1.5}, {0.5, 0.0, -1.5}, {1.5, 0.0, -1.5}},
     {{-1.5, 0.0, -0.5}, {-0.5, 1.0, -0.5}, {0.5, 1.0, -0.5}, {1.5, 0.0, -0.5}},
@@ -234,81 +275,29 @@ GLfloat hillPoints[4][4][3] = {
 
 
 /*\ ---- Helper Functions ---- \*/
-// Load bmp files
-BitMapFile *getBMPData(string filename) {
-    BitMapFile *bmp = new BitMapFile;
-    unsigned int size, offset, headerSize;
-    ifstream infile(filename.c_str(), ios::binary);
-    infile.seekg(10);
-    infile.read((char *) &offset, 4);
-    infile.read((char *) &headerSize, 4);
-    infile.seekg(18);
-    infile.read((char *) &bmp->sizeX, 4);
-    infile.read((char *) &bmp->sizeY, 4);
-    size = bmp->sizeX * bmp->sizeY * 24;
-    bmp->data = new unsigned char[size];
-    infile.seekg(offset);
-    infile.read((char *) bmp->data, size);
-    for (int i = 0; i < size; i += 3) {
-        char temp = bmp->data[i];
-        bmp->data[i] = bmp->data[i+2];
-        bmp->data[i+2] = temp;
-    }
-    return bmp;
-}
-// Load grass texture
-void loadGrassTexture() {
-    BitMapFile *image[1];
-    image[0] = getBMPData("textures/smallgrass.bmp");
-    
-    glGenTextures(1, textureGrass);
-    glBindTexture(GL_TEXTURE_2D, textureGrass[0]);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image[0]->sizeX, image[0]->sizeY, 0, GL_RGB, GL_UNSIGNED_BYTE, image[0]->data);
-
-    // Error check
-    GLenum err = glGetError();
-    if (err != GL_NO_ERROR) {
-        std::cerr << "OpenGL error: " << gluErrorString(err) << std::endl;
-    }
+// Milliseconds since the program started
+double millisecondsSinceStart() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - programStart).count();
 }
 // Generate a random float in range [min, max]
 float randomFloatInRange(float min, float max) {
     return min + ((float)rand() / (float)(RAND_MAX)) * (max - min);
 }
 // Routine to draw a bitmap character string.
+// Queue HUD text; everything queued is drawn at the end of the frame in one batch
 void drawText(const char* string, int x, int y) {
-    glDisable(GL_LIGHTING);
-    glColor3f(!day, !day, !day); // Set text color
-    glRasterPos2i(x, y); // Position the text correctly
-    while (*string) {
-        glutBitmapCharacter(GLUT_BITMAP_9_BY_15, *string++);
-    }
-    glEnable(GL_LIGHTING);
+    float color[3] = {(float)!day, (float)!day, (float)!day}; // Text color
+    queueText(hudText, GLUT_BITMAP_9_BY_15, string, x, y, color);
 }
 void renderCenteredText(const char* string) {
-    glDisable(GL_LIGHTING);
-    glColor3f(!day, !day, !day); // Set text color
-    int x = glutGet(GLUT_WINDOW_WIDTH) / 2 - strlen(string) * 4.5; // Approximate center
-    int y = glutGet(GLUT_WINDOW_HEIGHT) / 2 - 250;
+    float color[3] = {(float)!day, (float)!day, (float)!day}; // Text color
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    float x = viewport[2] / 2 - textWidth(hudText, GLUT_BITMAP_TIMES_ROMAN_24, string) / 2;
+    float y = viewport[3] / 2 - 250;
 
     // Position the text in the middle of the screen
-    glRasterPos2i(x, y);
-
-    // Loop through each character in the string
-    while(*string) {
-        glutBitmapCharacter(GLUT_BITMAP_TIMES_ROMAN_24, *string++);
-    }
-    glEnable(GL_LIGHTING);
-}
-// Routine to draw a stroke character string.
-void writeStrokeString(void *font, const char *string)
-{
-    const char *c;
-    for (c = string; *c != '\0'; c++) glutStrokeCharacter(font, *c);
+    queueText(hudText, GLUT_BITMAP_TIMES_ROMAN_24, string, x, y, color);
 }
 // Helper function to draw triangles
 void drawTriangles(float triangles[][4][3], int numTriangles) {
@@ -319,6 +308,7 @@ void drawTriangles(float triangles[][4][3], int numTriangles) {
             glVertex3fv(triangles[i][j]); // Pass the vertex to OpenGL
         }
         glEnd();
+        countDraw(3);
     }
 }
 // Helper function to draw quads
@@ -330,52 +320,7 @@ void drawQuads(float quads[][5][3], int numQuads) {
             glVertex3fv(quads[i][j]); // Pass the vertex to OpenGL
         }
         glEnd();
-    }
-}
-void drawReflectiveQuads(float quads[][5][3], int numQuads) {
-    for (int i = 0; i < numQuads; ++i) {
-        // Extract each corner point
-        float* v1 = quads[i][0];
-        float* v2 = quads[i][1];
-        float* v3 = quads[i][2];
-        float* v4 = quads[i][3];
-        float* normal = quads[i][4];
-
-        // Calculate dimensions
-        float width = sqrt(pow(v2[0] - v1[0], 2) + pow(v2[1] - v1[1], 2) + pow(v2[2] - v1[2], 2));
-        float height = sqrt(pow(v4[0] - v1[0], 2) + pow(v4[1] - v1[1], 2) + pow(v4[2] - v1[2], 2));
-
-        // Determine the number of large quads across the width and height (each segment is 10 units)
-        int numWidth = ceil(width / 2);
-        int numHeight = ceil(height / 2);
-
-        // Vector direction for width and height (each segment is 10 units long)
-        float widthVec[3] = {(v2[0] - v1[0]) / numWidth, (v2[1] - v1[1]) / numWidth, (v2[2] - v1[2]) / numWidth};
-        float heightVec[3] = {(v4[0] - v1[0]) / numHeight, (v4[1] - v1[1]) / numHeight, (v4[2] - v1[2]) / numHeight};
-
-        // Draw each large quad
-        glBegin(GL_QUADS);
-        for (int w = 0; w < numWidth; ++w) {
-            for (int h = 0; h < numHeight; ++h) {
-                // Calculate corners of the large quad
-                float base[3] = {
-                    v1[0] + w * widthVec[0] + h * heightVec[0],
-                    v1[1] + w * widthVec[1] + h * heightVec[1],
-                    v1[2] + w * widthVec[2] + h * heightVec[2]
-                };
-
-                float nextWidth[3] = {base[0] + widthVec[0], base[1] + widthVec[1], base[2] + widthVec[2]};
-                float nextHeight[3] = {base[0] + heightVec[0], base[1] + heightVec[1], base[2] + heightVec[2]};
-                float diagonal[3] = {nextWidth[0] + heightVec[0], nextWidth[1] + heightVec[1], nextWidth[2] + heightVec[2]};
-
-                glNormal3fv(normal);
-                glVertex3fv(base);
-                glVertex3fv(nextWidth);
-                glVertex3fv(diagonal);
-                glVertex3fv(nextHeight);
-            }
-        }
-        glEnd();
+        countDraw(4);
     }
 }
 // Function to draw a triangle fan circle in the XY plane
@@ -395,82 +340,9 @@ void drawCircleXY(float centerX, float centerY, float centerZ, float radius) {
     }
 
     glEnd();  // End drawing of circle
+    countDraw(numSegments + 2);
     glPopMatrix();  // Restore the previous transformation matrix
 }
-// Helper function to draw triangle strip circles, partial circles, washers in the XZ plane
-void drawCircle(float cx, float cy, float cz, float innerRadius, float outerRadius, float startAngle, float endAngle) {
-    glPushMatrix();
-    glTranslatef(cx, cy, cz);
-    glNormal3f(0, 1, 0);
-    glBegin(GL_TRIANGLE_STRIP);
-    for (int i = 0; i <= 50; ++i) {
-        float theta = startAngle + (endAngle - startAngle) * float(i) / float(50); // Current angle
-        float cosTheta = cosf(theta);
-        float sinTheta = sinf(theta);
-        // Outer vertex
-        float xOuter = outerRadius * cosTheta;
-        float zOuter = outerRadius * sinTheta;
-        glVertex3f(xOuter, 0.0f, zOuter); // Output vertex for outer radius
-        // Inner vertex
-        float xInner = innerRadius * cosTheta;
-        float zInner = innerRadius * sinTheta;
-        glVertex3f(xInner, 0.0f, zInner); // Output vertex for inner radius
-    }
-    glEnd();
-    glPopMatrix();
-}
-void drawCircles(float circles[][7], int numCircles) {
-    for (int i = 0; i < numCircles; ++i) {
-        drawCircle(
-            circles[i][0], circles[i][1], circles[i][2], // cx, cy, cz
-            circles[i][3], circles[i][4], // innerRadius, outerRadius
-            circles[i][5], circles[i][6]  // startAngle, endAngle
-        );
-    }
-}
-// Draw curved barrier wall
-void drawCurvedWall(float cx, float cy, float cz, float innerRadius, float outerRadius, float startAngle, float endAngle) {
-    glPushMatrix();
-    glTranslatef(cx, cy, cz);
-    glNormal3f(0, 1, 0);
-    glBegin(GL_TRIANGLE_STRIP);
-    for (int i = 0; i <= 50; ++i) {
-        float theta = startAngle + (endAngle - startAngle) * float(i) / float(50); // Current angle
-        float cosTheta = cosf(theta);
-        float sinTheta = sinf(theta);
-        glNormal3f(-cosTheta, 0.0f, -sinTheta);
-        // Outer vertex
-        float xOuter = innerRadius * cosTheta;
-        float zOuter = innerRadius * sinTheta;
-        glVertex3f(xOuter, 0.0f, zOuter);
-        // Inner vertex
-        float xInner = innerRadius * cosTheta;
-        float zInner = innerRadius * sinTheta;
-        glVertex3f(xInner, -cy, zInner);
-    }
-    glEnd();
-    glPopMatrix();
-    
-    glPushMatrix();
-    glTranslatef(cx, cy, cz);
-    glBegin(GL_TRIANGLE_STRIP);
-    for (int i = 0; i <= 50; ++i) {
-        float theta = startAngle + (endAngle - startAngle) * float(i) / float(50); // Current angle
-        float cosTheta = cosf(theta);
-        float sinTheta = sinf(theta);
-        glNormal3f(cosTheta, 0.0f, sinTheta);
-        // Outer vertex
-        float xOuter = outerRadius * cosTheta;
-        float zOuter = outerRadius * sinTheta;
-        glVertex3f(xOuter, 0.0f, zOuter);
-        // Inner vertex
-        float xInner = outerRadius * cosTheta;
-        float zInner = outerRadius * sinTheta;
-        glVertex3f(xInner, -cy, zInner);
-    }
-    glEnd();
-    glPopMatrix();
-}
 // Draw cylinder given 2 3D coordinates and a radius
 void drawCylinder(float x1, float y1, float z1, float x2, float y2, float z2, float radius) {
     GLUquadric* quadric = gluNewQuadric();
@@ -484,6 +356,7 @@ void drawCylinder(float x1, float y1, float z1, float x2, float y2, float z2, fl
     float angle = acos(dz/length) * 180.0 / M_PI; // Convert to degrees
     glRotatef(angle, -dy, dx, 0.0);
     gluCylinder(quadric, radius, radius, length, 20, 20);
+    countDraw(20 * 2 * 21, 20); // One quad strip per stack
     glPopMatrix();
 
     gluDeleteQuadric(quadric);
@@ -507,6 +380,7 @@ void drawAngledSliceCylinder(float x, float y, float z) {
 
     // Draw the cylinder
     gluCylinder(quadric, radius, radius, height, slices, stacks);
+    countDraw(stacks * 2 * (slices + 1), stacks);
 
     glDisable(GL_CLIP_PLANE0);
     gluDeleteQuadric(quadric);
@@ -533,22 +407,15 @@ void drawBoxFromCorners(float x1, float y1, float z1, float x2, float y2, float
         for (int j = 0; j < 4; ++j) glVertex3fv(vertices[faces[i][j]]);
     }
     glEnd();
-}
-
-
-// Function to draw multiple boxes given an array of box corner coordinates
-void drawMultipleBoxes(float boxes[][6], int numBoxes) {
-    for (int i = 0; i < numBoxes; i++) {
-        // Each 'boxes[i]' contains the parameters for 'drawBoxFromCorners'
-        drawBoxFromCorners(boxes[i][0], boxes[i][1], boxes[i][2],
-                           boxes[i][3], boxes[i][4], boxes[i][5]);
-    }
+    countDraw(24);
 }
 void setOrthographicProjection() {
     glMatrixMode(GL_PROJECTION);
     glPushMatrix();
     glLoadIdentity();
-    gluOrtho2D(0, glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT), 0);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport); // The window, as set in resize()
+    gluOrtho2D(0, viewport[2], viewport[3], 0);
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
 }
@@ -563,10 +430,12 @@ void resetPerspectiveProjection() {
 
 /*\ --- Drawing Functions ---- \*/
 void drawGrass(void) {
+    PROFILE_GL_SCOPE("grass");
     float extent = 10000.0f; // Large enough to cover the view
+    if (!boxVisible(-extent, -0.10f, -extent, extent, -0.10f, extent)) return;
     glColor3f(1, 1, 1);
     glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, textureGrass[0]);
+    glBindTexture(GL_TEXTURE_2D, textureGrass);
     glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
     glNormal3f(0.0, 1.0, 0.0);
     glBegin(GL_QUADS);
@@ -575,9 +444,10 @@ void drawGrass(void) {
         glTexCoord2f(100.0, 100.0); glVertex3f(extent, -0.10f, extent);
         glTexCoord2f(100.0, 0.0); glVertex3f(extent, -0.10f, -extent);
     glEnd();
+    countDraw(4);
     glDisable(GL_TEXTURE_2D);
 }
-void drawCloud(float x, float y, float z) {
+void drawCloud(float x, float y, float z, int level) {
     float cloudShade = day ? 0.9 : 0.2;
     glColor3f(cloudShade, cloudShade, cloudShade);
     glPushMatrix();
@@ -586,105 +456,312 @@ void drawCloud(float x, float y, float z) {
     for (int i = 0; i < 8; i++) {
         glPushMatrix();
         glTranslatef(cloudParts[i].offsetX, cloudParts[i].offsetY, cloudParts[i].offsetZ);
-        glutSolidSphere(cloudParts[i].size, 20, 20);
+        glScalef(cloudParts[i].size, cloudParts[i].size, cloudParts[i].size);
+        drawLodMesh(cloudPartLod, level);
         glPopMatrix();
     }
     glPopMatrix();
 }
+// Radius of a sphere around all parts of one cloud, in cloud units
+float cloudRadius() {
+    static float radius = 0;
+    if (radius == 0) {
+        for (int i = 0; i < 8; i++) {
+            const CloudPart& part = cloudParts[i];
+            float offset = sqrt(part.offsetX * part.offsetX + part.offsetY * part.offsetY + part.offsetZ * part.offsetZ);
+            radius = std::max(radius, offset + part.size);
+        }
+    }
+    return radius;
+}
+// Screen axes of impostor view k: the cloud seen slightly from below, from azimuth k
+void cloudViewAxes(int k, float right[3], float up[3]) {
+    float azimuth = 2 * M_PI * k / CLOUD_VIEWS;
+    float elevation = -20 * M_PI / 180; // Viewer below the cloud
+    float toViewer[3] = {sinf(azimuth) * cosf(elevation), sinf(elevation), cosf(azimuth) * cosf(elevation)};
+
+    // right = forward x worldUp, up = right x forward, with forward = -toViewer
+    float length = sqrt(toViewer[0] * toViewer[0] + toViewer[2] * toViewer[2]);
+    right[0] = toViewer[2] / length; right[1] = 0; right[2] = -toViewer[0] / length;
+    up[0] = right[1] * -toViewer[2] - right[2] * -toViewer[1];
+    up[1] = right[2] * -toViewer[0] - right[0] * -toViewer[2];
+    up[2] = right[0] * -toViewer[1] - right[1] * -toViewer[0];
+}
+// Bake the cloud silhouettes. Clouds are unlit and a single colour, so an orthographic
+// view of the parts is just overlapping discs; coverage is computed on the CPU with
+// 4x4 supersampling and stored as alpha, and the colour comes from glColor when drawn.
+// Fills cloudImpostorImage without touching GL.
+void bakeCloudImpostors() {
+    const int samples = 4;
+    float radius = cloudRadius();
+    int width = CLOUD_VIEW_SIZE * CLOUD_VIEWS;
+    Image &image = cloudImpostorImage;
+    initImage(image, width, CLOUD_VIEW_SIZE, 1);
+
+    for (int k = 0; k < CLOUD_VIEWS; k++) {
+        float right[3], up[3];
+        cloudViewAxes(k, right, up);
+        float discX[8], discY[8];
+        for (int i = 0; i < 8; i++) {
+            discX[i] = cloudParts[i].offsetX * right[0] + cloudParts[i].offsetY * right[1] + cloudParts[i].offsetZ * right[2];
+            discY[i] = cloudParts[i].offsetX * up[0] + cloudParts[i].offsetY * up[1] + cloudParts[i].offsetZ * up[2];
+        }
+        for (int row = 0; row < CLOUD_VIEW_SIZE; row++) {
+            for (int col = 0; col < CLOUD_VIEW_SIZE; col++) {
+                int covered = 0;
+                for (int sy = 0; sy < samples; sy++) {
+                    for (int sx = 0; sx < samples; sx++) {
+                        float x = ((col + (sx + 0.5f) / samples) / CLOUD_VIEW_SIZE * 2 - 1) * radius;
+                        float y = ((row + (sy + 0.5f) / samples) / CLOUD_VIEW_SIZE * 2 - 1) * radius;
+                        for (int i = 0; i < 8; i++) {
+                            float dx = x - discX[i], dy = y - discY[i];
+                            if (dx * dx + dy * dy <= cloudParts[i].size * cloudParts[i].size) { covered++; break; }
+                        }
+                    }
+                }
+                image.pixels[(size_t)row * width + k * CLOUD_VIEW_SIZE + col] = covered * 255 / (samples * samples);
+            }
+        }
+    }
+
+    buildMipChain(image);
+}
+// Place clouds beyond the fixed ones until there are cloudCount
+void generateExtraClouds() {
+    cloudPositions.resize(std::min((size_t)cloudCount, cloudPositions.size()));
+    while (cloudPositions.size() < (size_t)cloudCount) {
+        CloudPosition cloud = {randomFloatInRange(-30, 30), randomFloatInRange(5, 9), randomFloatInRange(-25, 25)};
+        cloudPositions.push_back(cloud);
+    }
+}
+// Where a cloud has blown to: along z, wrapping from 25 back to -25
+CloudPosition driftedCloud(const CloudPosition& cloud, float drift) {
+    CloudPosition moved = cloud;
+    moved.z = fmod(cloud.z + 25 + drift, 50) - 25;
+    return moved;
+}
+// Camera-facing quads, each textured with the view closest to the camera's direction
+void drawCloudImpostors() {
+    float view[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, view);
+    float right[3] = {view[0], view[4], view[8]};
+    float up[3] = {view[1], view[5], view[9]};
+    float eye[3]; // Camera position: -R^T t
+    for (int a = 0; a < 3; a++) eye[a] = -(view[4 * a] * view[12] + view[4 * a + 1] * view[13] + view[4 * a + 2] * view[14]);
+
+    float scale = 40;
+    float half = cloudRadius() * scale;
+    float cloudShade = day ? 0.9 : 0.2;
+
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, cloudImpostorTexture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glEnable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GREATER, 0.5f);
+    glColor3f(cloudShade, cloudShade, cloudShade);
+
+    int quads = 0;
+    glBegin(GL_QUADS);
+    for (const CloudPosition& placed : cloudPositions) {
+        CloudPosition cloud = driftedCloud(placed, shown->cloudDrift);
+        float cx = cloud.x * scale, cy = cloud.y * scale, cz = cloud.z * scale;
+        if (!sphereVisible(cx, cy, cz, half)) continue;
+        quads++;
+        float azimuth = atan2(eye[0] - cx, eye[2] - cz);
+        int k = ((int)lround(azimuth / (2 * M_PI) * CLOUD_VIEWS) % CLOUD_VIEWS + CLOUD_VIEWS) % CLOUD_VIEWS;
+        float u0 = (float)k / CLOUD_VIEWS, u1 = (float)(k + 1) / CLOUD_VIEWS;
+
+        glTexCoord2f(u0, 0);
+        glVertex3f(cx - (right[0] + up[0]) * half, cy - (right[1] + up[1]) * half, cz - (right[2] + up[2]) * half);
+        glTexCoord2f(u1, 0);
+        glVertex3f(cx + (right[0] - up[0]) * half, cy + (right[1] - up[1]) * half, cz + (right[2] - up[2]) * half);
+        glTexCoord2f(u1, 1);
+        glVertex3f(cx + (right[0] + up[0]) * half, cy + (right[1] + up[1]) * half, cz + (right[2] + up[2]) * half);
+        glTexCoord2f(u0, 1);
+        glVertex3f(cx - (right[0] - up[0]) * half, cy - (right[1] - up[1]) * half, cz - (right[2] - up[2]) * half);
+    }
+    glEnd();
+    countDraw(4 * quads);
+
+    glDisable(GL_ALPHA_TEST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+}
 void drawClouds() {
+    PROFILE_GL_SCOPE("clouds");
+
     glDisable(GL_LIGHTING);
-    for (int i = 0; i < 6; i++) {
-        glPushMatrix();
-        glScalef(40, 40, 40);
-        drawCloud(cloudPositions[i].x, cloudPositions[i].y, cloudPositions[i].z);
-        glPopMatrix();
+    if (cloudImpostors) {
+        drawCloudImpostors();
+    } else {
+        for (const CloudPosition& placed : cloudPositions) {
+            CloudPosition cloud = driftedCloud(placed, shown->cloudDrift);
+            float scale = 40;
+            if (!sphereVisible(cloud.x * scale, cloud.y * scale, cloud.z * scale, cloudRadius() * scale)) continue;
+            int level = selectLod(cloud.x * scale, cloud.y * scale, cloud.z * scale, cloudRadius() * scale);
+            glPushMatrix();
+            glScalef(scale, scale, scale);
+            drawCloud(cloud.x, cloud.y, cloud.z, level);
+            glPopMatrix();
+        }
     }
     glEnable(GL_LIGHTING);
 }
 void drawHill(float x, float y, float z, float scale) {
+    PROFILE_GL_SCOPE("hill");
+    // The surface stays inside the hull of its control points
+    if (!boxVisible(x - 1.5 * scale, y, z - 1.5 * scale, x + 1.5 * scale, y + scale, z + 1.5 * scale)) return;
+    int level = selectLod(x, y + 0.5 * scale, z, 1.6 * scale);
+
+    glColor3f(1, 1, 1);
     glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, textureGrass[0]);
+    glBindTexture(GL_TEXTURE_2D, textureGrass);
     glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, day ? GL_REPLACE : GL_MODULATE);
 
+    // Normals are scaled along with the patch
+    GLboolean normalize = glIsEnabled(GL_NORMALIZE);
+    glEnable(GL_NORMALIZE);
+
     glPushMatrix();
     glTranslatef(x, y, z);
     glScalef(scale, scale, scale); // Adjust scale to desired hill size
-
-    for (int i = 0; i <= 3; i++) {
-        for (int j = 0; j <= 3; j++) {
-            glMap2f(GL_MAP2_VERTEX_3, 0, 1, 3, 4, 0, 1, 12, 4, &hillPoints[0][0][0]);
-            glMap2f(GL_MAP2_TEXTURE_COORD_2, 0, 1, 2, 2, 0, 1, 8, 2, &hillPoints[0][0][0]);  // Adjusted texture points
-            glEnable(GL_MAP2_TEXTURE_COORD_2);
-            glEnable(GL_MAP2_VERTEX_3);
-            glMapGrid2f(10, 0.0, 1.0, 20, 0.0, 1.0);
-            glEvalMesh2(GL_FILL, 0, 20, 0, 20);
-        }
-    }
-
+    drawLodMesh(hillLod, level);
     glPopMatrix();
+
+    if (!normalize) glDisable(GL_NORMALIZE);
     glDisable(GL_TEXTURE_2D);
 }
-void drawTree(float x, float y, float z, float trunkHeight, float foliageRadius) {
-    float trunkRadius = 3;  // Radius of the trunk
-    float foliageHeight = 20.0f; // Height of the foliage
+// Tessellate every level-of-detail primitive once (no GL; uploadLodMeshes() hands them over).
+// Full detail matches the glutSolidSphere/glutSolidTorus/gluCylinder/glEvalMesh2 calls they replace.
+void buildLodMeshes() {
+    // Trees, drawn once per instance: a unit trunk cylinder and a unit foliage cone
+    buildLodCylinder(trunkLod, 1, 1, 1, 20, 20);
+    buildLodCylinder(foliageLod, 1, 0, 1, 20, 20); // Cone: large base, zero at top
+
+    // Racecar
+    buildLodSphere(driverLod, 5, 100, 100);
+    buildLodTorus(tireLod, 1.5, 5, 30, 30);
+    buildLodDisc(discLod, 1, 360);
+    buildLodCylinder(axleLod, 1, 1, 25, 20, 20);
+
+    // Sky
+    buildLodSphere(cloudPartLod, 1, 20, 20);
+    buildLodSphere(sunLod, 20, 30, 30);
+    buildLodSphere(moonLod, 10, 30, 30);
+
+    // Terrain
+    buildLodBezierPatch(hillLod, hillPoints, hillSegments, 2);
+}
+void uploadLodMeshes() {
+    for (LodMesh *lod : {&trunkLod, &foliageLod, &driverLod, &tireLod, &discLod, &axleLod, &cloudPartLod, &sunLod, &moonLod, &hillLod}) {
+        uploadLodMesh(*lod);
+    }
+}
+// Scatter randomTreeCount trees outside the track area
+void generateRandomTrees() {
+    // Track floor bounds, with a margin
+    float minX = 0, minZ = 0, maxX = 0, maxZ = 0;
+    for (int i = 0; i < trackQuadsCount; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            minX = std::min(minX, trackQuads[i][j][0]); maxX = std::max(maxX, trackQuads[i][j][0]);
+            minZ = std::min(minZ, trackQuads[i][j][2]); maxZ = std::max(maxZ, trackQuads[i][j][2]);
+        }
+    }
+    for (int i = 0; i < trackCurvesCount; ++i) {
+        float radius = std::max(trackCurves[i][3], trackCurves[i][4]);
+        minX = std::min(minX, trackCurves[i][0] - radius); maxX = std::max(maxX, trackCurves[i][0] + radius);
+        minZ = std::min(minZ, trackCurves[i][2] - radius); maxZ = std::max(maxZ, trackCurves[i][2] + radius);
+    }
+    minX -= 10; minZ -= 20; maxX += 10; maxZ += 20;
 
-    glPushMatrix();
+    srand(time(nullptr)); // Seed random number generator
+    randomTrees.clear();
+    for (int i = 0; i < randomTreeCount; ++i) {
+        float x, z;
+        do { // Twice the track's extent around it
+            x = minX - (maxX - minX) / 2 + rand() % (int)(2 * (maxX - minX));
+            z = minZ - (maxZ - minZ) / 2 + rand() % (int)(2 * (maxZ - minZ));
+        } while ((x > minX && x < maxX) && (z > minZ && z < maxZ));
 
-    // Position the entire tree
-    glTranslatef(x, y, z);
+        float trunkHeight = rand() % 4 + 6; // Random trunk height between 6 and 10
+        float treeHeight = trunkHeight + (rand() % 5 + 5); // Total tree height will be trunk height plus 5 to 10
 
-    // Draw the trunk using custom drawCylinder
+        randomTrees.emplace_back(x, 0, z, trunkHeight, treeHeight);
+    }
+}
+// Level of detail for each tree from a sphere around trunk and foliage, or -1 if it is out of view
+void selectTreeLods(const std::vector<Tree>& forest, std::vector<int>& levels) {
+    levels.resize(forest.size());
+    for (size_t t = 0; t < forest.size(); ++t) {
+        const Tree& tree = forest[t];
+        float halfHeight = (3 * tree.trunkHeight + 20) / 2;
+        float radius = std::max(halfHeight, tree.treeHeight);
+        bool visible = sphereVisible(tree.x, tree.y + halfHeight, tree.z, radius);
+        levels[t] = visible ? selectLod(tree.x, tree.y + halfHeight, tree.z, radius) : -1;
+    }
+}
+void drawTreeTrunks(const std::vector<Tree>& forest, const std::vector<int>& levels, int level) {
+    float trunkRadius = 3;  // Radius of the trunk
     glColor3f(0.55f, 0.27f, 0.07f); // Brown color for the trunk
-    drawCylinder(0, 0, 0, 0, trunkHeight, 0, trunkRadius);
-
-    // Draw the foliage as a cone using gluCylinder
-    glColor3f(0.0f, 0.4f, 0.0f); // Green color for the foliage
-    for(int i = 0; i < 3; i++){
+    for (size_t t = 0; t < forest.size(); ++t) {
+        if (levels[t] != level) continue;
+        const Tree& tree = forest[t];
         glPushMatrix();
-        glTranslatef(0.0f, trunkHeight + (i * trunkHeight), 0.0f); // Move to the position for the foliage
-        glRotatef(-90, 1, 0, 0);
-        GLUquadric* quad = gluNewQuadric();
-        gluCylinder(quad, foliageRadius - (i * 2.5), 0.0f, foliageHeight - (i * 2.5), 20, 20); // Cone: large base, zero at top
-        gluDeleteQuadric(quad);
+        glTranslatef(tree.x, tree.y, tree.z);
+        glScalef(trunkRadius, tree.trunkHeight, trunkRadius);
+        drawMeshInstance(trunkLod.levels[level]);
         glPopMatrix();
+        countLod(trunkLod, level);
     }
-
-    glPopMatrix();
 }
-void drawTrees() {
-    for (const auto& tree : trees) {
-        drawTree(tree.x, tree.y, tree.z, tree.trunkHeight, tree.treeHeight);
-    }
-    
-    static std::vector<Tree> trees;
-    static bool initialized = false;
-
-    if (!initialized) {
-        srand(time(nullptr)); // Seed random number generator
-        // Generate random positions for trees
-        for (int i = 0; i < 50; ++i) {  // Generate 50 trees
-            float x, z;
-            do {
-                x = rand() % 1220 - 610;  // Range from -610 to 610
-                z = rand() % 1640 - 820;  // Range from -820 to 820
-            } while ((x > -290 && x < 330) && (z > -420 && z < 420));
-
-            float trunkHeight = rand() % 4 + 6; // Random trunk height between 6 and 10
-            float treeHeight = trunkHeight + (rand() % 5 + 5); // Total tree height will be trunk height plus 5 to 10
-
-            trees.emplace_back(x, 0, z, trunkHeight, treeHeight);
+void drawTreeFoliage(const std::vector<Tree>& forest, const std::vector<int>& levels, int level) {
+    float foliageHeight = 20.0f; // Height of the foliage
+    glColor3f(0.0f, 0.4f, 0.0f); // Green color for the foliage
+    for (size_t t = 0; t < forest.size(); ++t) {
+        if (levels[t] != level) continue;
+        const Tree& tree = forest[t];
+        float foliageRadius = tree.treeHeight;
+        for(int i = 0; i < 3; i++){
+            glPushMatrix();
+            glTranslatef(tree.x, tree.y + tree.trunkHeight + (i * tree.trunkHeight), tree.z); // Move to the position for the foliage
+            glScalef(foliageRadius - (i * 2.5), foliageHeight - (i * 2.5), foliageRadius - (i * 2.5));
+            drawMeshInstance(foliageLod.levels[level]);
+            glPopMatrix();
         }
-        initialized = true;
+        countLod(foliageLod, level, 3);
     }
-
-    // Draw all trees
-    for (const auto& tree : trees) {
-        drawTree(tree.x, tree.y, tree.z, tree.trunkHeight, tree.treeHeight);
+}
+void drawTrees() {
+    PROFILE_GL_SCOPE("trees");
+    if (randomTrees.size() != (size_t)randomTreeCount) generateRandomTrees();
+
+    static std::vector<int> treeLevels, randomTreeLevels;
+    selectTreeLods(trees, treeLevels);
+    selectTreeLods(randomTrees, randomTreeLevels);
+
+    // Instances are scaled unevenly, so normals need renormalizing
+    GLboolean normalize = glIsEnabled(GL_NORMALIZE);
+    glEnable(GL_NORMALIZE);
+
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        beginMeshInstances(trunkLod.levels[level]);
+        drawTreeTrunks(trees, treeLevels, level);
+        drawTreeTrunks(randomTrees, randomTreeLevels, level);
+        endMeshInstances(trunkLod.levels[level]);
+
+        beginMeshInstances(foliageLod.levels[level]);
+        drawTreeFoliage(trees, treeLevels, level);
+        drawTreeFoliage(randomTrees, randomTreeLevels, level);
+        endMeshInstances(foliageLod.levels[level]);
     }
+
+    if (!normalize) glDisable(GL_NORMALIZE);
 }
 void drawSun() {
-    glPushMatrix();
+    PROFILE_GL_SCOPE("sun");
     float sunRadius = 20.0f; // Large radius for the sun
+    if (!sphereVisible(400, 300, 1000, sunRadius)) return;
+    glPushMatrix();
 
     // Move to the position and draw the sun
     glTranslatef(400, 300, 1000); // Adjust these values based on your scene
@@ -694,10 +771,8 @@ void drawSun() {
     GLfloat mat_emission[] = {0.9f, 0.8f, 0.2f, 1.0f};
     glMaterialfv(GL_FRONT, GL_EMISSION, mat_emission);
 
-    // Create a quadric object to draw sphere
-    GLUquadric* quadric = gluNewQuadric();
-    gluSphere(quadric, sunRadius, 30, 30); // Draw sphere
-    gluDeleteQuadric(quadric);
+    // Draw sphere
+    drawLodMesh(sunLod, selectLod(400, 300, 1000, sunRadius));
 
     // Reset emission material to none
     GLfloat no_mat[] = {0.0f, 0.0f, 0.0f, 1.0f};
@@ -706,8 +781,10 @@ void drawSun() {
     glPopMatrix();
 }
 void drawMoon() {
-    glPushMatrix();
+    PROFILE_GL_SCOPE("moon");
     float moonRadius = 10.0f;
+    if (!sphereVisible(-400, 300, -1000, moonRadius)) return;
+    glPushMatrix();
 
     // Move to the position and draw the sun
     glTranslatef(-400, 300, -1000); // Adjust these values based on your scene
@@ -717,10 +794,8 @@ void drawMoon() {
     GLfloat mat_emission[] = {0.9f, 0.9f, 0.9f, 1.0f};
     glMaterialfv(GL_FRONT, GL_EMISSION, mat_emission);
 
-    // Create a quadric object to draw sphere
-    GLUquadric* quadric = gluNewQuadric();
-    gluSphere(quadric, moonRadius, 30, 30); // Draw sphere
-    gluDeleteQuadric(quadric);
+    // Draw sphere
+    drawLodMesh(moonLod, selectLod(-400, 300, -1000, moonRadius));
 
     // Reset emission material to none
     GLfloat no_mat[] = {0.0f, 0.0f, 0.0f, 1.0f};
@@ -729,10 +804,12 @@ void drawMoon() {
     glPopMatrix();
 }
 void drawStartFinishLine(void) {
+    PROFILE_GL_SCOPE("start line");
     int numSegments = 20;  // Number of checkered segments
     float segmentLength = (280.0f - 200.0f) / numSegments;
     float startY = -5.0f;  // Starting y-coordinate for the checkered pattern
     float stripeHeight = 5.0f;  // Height of each stripe
+    if (!boxVisible(200, 0.5f, startY, 280, 0.5f, startY + 2 * stripeHeight)) return;
 
     glDisable(GL_LIGHTING);
     glBegin(GL_QUADS);
@@ -757,9 +834,11 @@ void drawStartFinishLine(void) {
         }
     }
     glEnd(); // End drawing
+    countDraw(4 * 2 * numSegments);
     glEnable(GL_LIGHTING);
 }
 void drawStartLight(){
+    PROFILE_GL_SCOPE("start light");
     float baseX = 252.5f;
     float baseY = 32.0f;
     float baseZ = -3.1f;
@@ -768,6 +847,7 @@ void drawStartLight(){
     int numLightsPerRow = 6;
     float radius = 1.4f;
     float colors[4][3] = {{1.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 0.0f}};
+    if (!boxVisible(178, 0, -6, 302, 43, 2)) return; // Gantry, posts, panel and light covers
     
     // Main structure and base
     glColor3f(0.8f, 0.8f, 0.8f);
@@ -796,74 +876,200 @@ void drawStartLight(){
         }
     }
 }
-void initConfetti(ConfettiParticle confetti[], float posX, float posY, float posZ) {
-    for (int i = 0; i < MAX_CONFETTI; i++) {
-        confetti[i].position[0] = posX;
-        confetti[i].position[1] = posY;
-        confetti[i].position[2] = posZ;
-        confetti[i].velocity[0] = (rand() % 20 - 10) * 0.05;
-        confetti[i].velocity[1] = (rand() % 30 + 10) * 0.25;
-        confetti[i].velocity[2] = (rand() % 20 - 10) * 0.05;
-        confetti[i].color[0] = rand() / (float)RAND_MAX;
-        confetti[i].color[1] = rand() / (float)RAND_MAX;
-        confetti[i].color[2] = rand() / (float)RAND_MAX;
-        confetti[i].active = true;
+// Tessellate the track floor, curves and barriers once into static meshes (no GL)
+void buildTrackMeshes() {
+    clearMesh(trackFloorMesh);
+    clearMesh(trackMesh);
+
+    for (int i = 0; i < trackQuadsCount; ++i) {
+        meshPart(trackFloorMesh, 0.35, 0.35, 0.35);
+        meshQuad(trackFloorMesh, trackQuads[i][0], trackQuads[i][1], trackQuads[i][2], trackQuads[i][3], trackQuads[i][4]);
+    }
+
+    for (int i = 0; i < trackCurvesCount; ++i) {
+        float* curve = trackCurves[i];
+        meshPart(trackMesh, 0.35, 0.35, 0.35);
+        meshRing(trackMesh, curve[0], curve[1], curve[2], curve[3], curve[4], curve[5], curve[6]);
+    }
+    for (int i = 0; i < axisBarriersCount; ++i) {
+        float* box = axisBarriers[i];
+        meshPart(trackMesh, 0.75, 0, 0);
+        meshBox(trackMesh, box[0], box[1], box[2], box[3], box[4], box[5]);
     }
+    for (int i = 0; i < curveBarriersCount; ++i) {
+        float* barrier = curveBarriers[i];
+        meshPart(trackMesh, 0.75, 0, 0);
+        meshRing(trackMesh, barrier[0], barrier[1], barrier[2], barrier[3], barrier[4], barrier[5], barrier[6]);
+        meshCurvedWall(trackMesh, barrier[0], barrier[1], barrier[2], barrier[4], barrier[3], barrier[5], barrier[6]);
+    }
+
 }
-void updateAndDrawConfetti(ConfettiParticle confetti[]) {
-    glPointSize(10.0); // Set point size for confetti particles
-    glDisable(GL_LIGHTING);
-    glBegin(GL_POINTS);
-    for (int i = 0; i < MAX_CONFETTI; i++) {
-        if (confetti[i].active) {
-            // Update position
-            confetti[i].position[0] += confetti[i].velocity[0];
-            confetti[i].position[1] += confetti[i].velocity[1];
-            confetti[i].position[2] += confetti[i].velocity[2];
-
-            // Apply gravity
-            confetti[i].velocity[1] -= 0.1; // gravity effect
-
-            // Draw particle
-            glColor3fv(confetti[i].color);
-            glVertex3fv(confetti[i].position);
-
-            // Deactivate confetti that falls below a certain height
-            if (confetti[i].position[1] < -1) {
-                confetti[i].active = false;
+void uploadTrackMeshes() {
+    uploadMesh(trackFloorMesh);
+    uploadMesh(trackMesh);
+}
+// Draw the parts of a mesh whose bounding box is in view, with one call for
+// each run of consecutive visible parts of the same colour
+void drawVisibleParts(const Mesh& mesh) {
+    beginMeshInstances(mesh);
+    int runFirst = 0, runCount = 0;
+    for (int i = 0; i < (int)mesh.parts.size(); ++i) {
+        const MeshPart &part = mesh.parts[i], &run = mesh.parts[runFirst];
+        if (!boxVisible(part.min, part.max)) continue;
+        bool sameColor = part.hasColor == run.hasColor && std::equal(part.color, part.color + 3, run.color);
+        if (runCount && i == runFirst + runCount && sameColor) {
+            runCount++; // Extends the run
+            continue;
+        }
+        drawMeshParts(mesh, runFirst, runCount);
+        runFirst = i;
+        runCount = 1;
+    }
+    drawMeshParts(mesh, runFirst, runCount);
+    endMeshInstances(mesh);
+}
+// Night-mode floor: the track quads subdivided into 2x2-unit cells so the
+// vertex-lit headlights form pools, in tiles of up to 10x10 cells. Each tile
+// size is tessellated once, as a fine grid and a one-quad coarse part, and
+// every tile draws its size's grid through its own transform (no GL).
+void buildNightFloorMesh(float quads[][5][3], int numQuads) {
+    const int tileCells = 10; // Fine cells per tile side
+    int sizeParts[tileCells + 1][tileCells + 1]; // Fine part of each tile size, or -1
+    std::fill(&sizeParts[0][0], &sizeParts[0][0] + (tileCells + 1) * (tileCells + 1), -1);
+    clearMesh(nightFloorMesh);
+    nightFloorTiles.clear();
+    if (numQuads > MAX_NIGHT_FLOOR_QUADS) return; // Drawn unsubdivided
+
+    for (int i = 0; i < numQuads; ++i) {
+        // Extract each corner point
+        float* v1 = quads[i][0];
+        float* v2 = quads[i][1];
+        float* v4 = quads[i][3];
+        float* normal = quads[i][4];
+
+        // Calculate dimensions
+        float width = sqrt(pow(v2[0] - v1[0], 2) + pow(v2[1] - v1[1], 2) + pow(v2[2] - v1[2], 2));
+        float height = sqrt(pow(v4[0] - v1[0], 2) + pow(v4[1] - v1[1], 2) + pow(v4[2] - v1[2], 2));
+
+        // Determine the number of cells across the width and height (each cell is 2 units)
+        int numWidth = ceil(width / 2);
+        int numHeight = ceil(height / 2);
+
+        // Vector direction for width and height of one cell
+        float widthVec[3] = {(v2[0] - v1[0]) / numWidth, (v2[1] - v1[1]) / numWidth, (v2[2] - v1[2]) / numWidth};
+        float heightVec[3] = {(v4[0] - v1[0]) / numHeight, (v4[1] - v1[1]) / numHeight, (v4[2] - v1[2]) / numHeight};
+
+        for (int tileW = 0; tileW < numWidth; tileW += tileCells) {
+            for (int tileH = 0; tileH < numHeight; tileH += tileCells) {
+                int cellsW = std::min(tileCells, numWidth - tileW);
+                int cellsH = std::min(tileCells, numHeight - tileH);
+
+                // Grid of this size, with cell (u, v) at (u, 0, v)
+                int &part = sizeParts[cellsW][cellsH];
+                if (part < 0) {
+                    const float up[3] = {0, 1, 0};
+                    part = (int)nightFloorMesh.parts.size();
+                    meshPart(nightFloorMesh, 0.35, 0.35, 0.35);
+                    for (int u = 0; u < cellsW; ++u) {
+                        for (int v = 0; v < cellsH; ++v) {
+                            float a[3] = {(float)u, 0, (float)v}, b[3] = {(float)u + 1, 0, (float)v};
+                            float c[3] = {(float)u + 1, 0, (float)v + 1}, d[3] = {(float)u, 0, (float)v + 1};
+                            meshQuad(nightFloorMesh, a, b, c, d, up);
+                        }
+                    }
+                    float a[3] = {0, 0, 0}, b[3] = {(float)cellsW, 0, 0};
+                    float c[3] = {(float)cellsW, 0, (float)cellsH}, d[3] = {0, 0, (float)cellsH};
+                    meshPart(nightFloorMesh, 0.35, 0.35, 0.35);
+                    meshQuad(nightFloorMesh, a, b, c, d, up);
+                }
+
+                // Cell (u, v) of the grid lands on cell (tileW + u, tileH + v) of the quad.
+                // With a unit normal, normals come out exactly as the quad's.
+                FloorTile tile;
+                tile.part = part;
+                float *m = tile.transform;
+                for (int k = 0; k < 3; ++k) {
+                    m[k] = widthVec[k];
+                    m[4 + k] = normal[k];
+                    m[8 + k] = heightVec[k];
+                    m[12 + k] = v1[k] + tileW * widthVec[k] + tileH * heightVec[k];
+                }
+                m[3] = m[7] = m[11] = 0;
+                m[15] = 1;
+
+                float corners[4][3];
+                for (int k = 0; k < 3; ++k) {
+                    corners[0][k] = m[12 + k];
+                    corners[1][k] = m[12 + k] + cellsW * widthVec[k];
+                    corners[2][k] = m[12 + k] + cellsW * widthVec[k] + cellsH * heightVec[k];
+                    corners[3][k] = m[12 + k] + cellsH * heightVec[k];
+                    tile.min[k] = std::min(std::min(corners[0][k], corners[1][k]), std::min(corners[2][k], corners[3][k]));
+                    tile.max[k] = std::max(std::max(corners[0][k], corners[1][k]), std::max(corners[2][k], corners[3][k]));
+                }
+
+                // Bounding circle of the tile on the ground
+                float *a = corners[0], *b = corners[1], *c = corners[2], *d = corners[3];
+                tile.x = (a[0] + c[0]) / 2;
+                tile.z = (a[2] + c[2]) / 2;
+                tile.radius = std::max(sqrt(pow(c[0] - a[0], 2) + pow(c[2] - a[2], 2)),
+                                       sqrt(pow(d[0] - b[0], 2) + pow(d[2] - b[2], 2))) / 2;
+                nightFloorTiles.push_back(tile);
             }
         }
     }
-    glEnd();
-    glEnable(GL_LIGHTING);
+}
+void uploadNightFloorMesh() {
+    uploadMesh(nightFloorMesh);
+    dropMeshVertices(nightFloorMesh);
+}
+// Fine tiles near the car, coarse ones beyond nightDetailRadius (if set).
+// Tracks too big for a subdivided floor get the day floor.
+void drawNightFloor() {
+    if (nightFloorTiles.empty()) {
+        drawVisibleParts(trackFloorMesh);
+        return;
+    }
+    beginMeshInstances(nightFloorMesh);
+    for (const FloorTile& tile : nightFloorTiles) {
+        if (!boxVisible(tile.min, tile.max)) continue;
+        float dx = tile.x - drawnSim.meX, dz = tile.z - drawnSim.meZ;
+        float reach = nightDetailRadius + tile.radius;
+        bool fine = nightDetailRadius <= 0 || dx * dx + dz * dz <= reach * reach;
+        glPushMatrix();
+        glMultMatrixf(tile.transform);
+        drawMeshPart(nightFloorMesh, tile.part + (fine ? 0 : 1));
+        glPopMatrix();
+    }
+    endMeshInstances(nightFloorMesh);
 }
 void drawTrack(void){
+    PROFILE_GL_SCOPE("track");
     // Drawing the floor
-    glColor3f(0.35, 0.35, 0.35);
-    if(day){drawQuads(trackQuads, 9);}
-    else{drawReflectiveQuads(trackQuads, 9);}
-    drawCircles(trackCurves, 9);
-    
-    // Drawing the barriers
-    glColor3f(0.75, 0, 0);
-    drawMultipleBoxes(axisBarriers, axisBarriersCount);
-    drawCircles(curveBarriers, curveBarriersCount);
-    
-    for (int i = 0; i < curveBarriersCount; ++i) {
-        float* barrier = curveBarriers[i];
-        drawCurvedWall(barrier[0], barrier[1], barrier[2], barrier[4], barrier[3], barrier[5], barrier[6]);
-    }
+    if(day){drawVisibleParts(trackFloorMesh);}
+    else{drawNightFloor();}
+
+    // Drawing the curves and barriers
+    drawVisibleParts(trackMesh);
 }
 void drawTeapot(void){
+    PROFILE_GL_SCOPE("teapot");
+    if (!sphereVisible(0, 25, 0, 80)) return; // The spout reaches about 1.7 sizes from the centre
     glPushMatrix();
     glTranslatef(0.0f, 25.0f, 0.0f);
-    glRotatef(teapotRotationAngle, 0, 1, 0);
+    glRotatef(shown->teapotAngle, 0, 1, 0);
     glColor3f(1.0f, 0.8f, 0.0f);
-    glutSolidTeapot(40.0); // The parameter is the radius of the teapot
+    if (offscreen) { // GLUT shapes need a GLUT window: a sphere of the same size stands in
+        GLUquadric* quadric = gluNewQuadric();
+        gluSphere(quadric, 40.0, 20, 20);
+        gluDeleteQuadric(quadric);
+        countDraw(802, 20); // As GLU draws it: a fan at each pole, a quad strip per stack between
+    } else {
+        glutSolidTeapot(40.0); // The parameter is the radius of the teapot
+    }
     glPopMatrix();
 }
 void updateHeadlights() {
-    float rad = angleX * PI / 180.0;
+    float rad = drawnSim.angleX * PI / 180.0;
     float lightDirX = sin(rad);
     float lightDirZ = cos(rad);
     float headlightOffsetX = 2; // distance to the left and right from the center
@@ -872,15 +1078,15 @@ void updateHeadlights() {
 
     // Calculate positions of the left and right headlights
     GLfloat light0Pos[] = {
-        meX - lightDirZ * headlightOffsetX + lightDirX * headlightForward,
+        drawnSim.meX - lightDirZ * headlightOffsetX + lightDirX * headlightForward,
         headlightHeight,
-        meZ + lightDirX * headlightOffsetX + lightDirZ * headlightForward,
+        drawnSim.meZ + lightDirX * headlightOffsetX + lightDirZ * headlightForward,
         1.0
     };
     GLfloat light1Pos[] = {
-        meX + lightDirZ * headlightOffsetX + lightDirX * headlightForward,
+        drawnSim.meX + lightDirZ * headlightOffsetX + lightDirX * headlightForward,
         headlightHeight,
-        meZ - lightDirX * headlightOffsetX + lightDirZ * headlightForward,
+        drawnSim.meZ - lightDirX * headlightOffsetX + lightDirZ * headlightForward,
         1.0
     };
 
@@ -897,26 +1103,32 @@ void updateHeadlights() {
 }
 
 // Draw racecar wheel using torus
-void drawWheel(float x, float y, float z, float angle) {
-    float wheelWidth = 1.5f;
-    float wheelRadius = 5.0f;
+// Level-of-detail version of drawCircleXY()
+void drawDisc(float centerX, float centerY, float centerZ, float radius, int level) {
+    glPushMatrix();
+    glTranslatef(centerX, centerY, centerZ);
+    glScalef(radius, radius, 1);
+    drawLodMesh(discLod, level);
+    glPopMatrix();
+}
+void drawWheel(float x, float y, float z, float angle, int level) {
     glColor3f(0.0f, 0.0f, 0.0f);
     for(float i = 0.7; i <= 1; i += 0.05){
         glPushMatrix();
         glTranslatef(x * i, y, z + (abs(x)/x * 0.1 * (0.85 - i) * angle));
         glRotatef(90 + angle, 0.0f, 1.0f, 0.0f);
-        glutSolidTorus(wheelWidth, wheelRadius, 30, 30);
+        drawLodMesh(tireLod, level);
         glPopMatrix();
     }
     glPushMatrix();
     glColor3f(0.75f, 0.75f, 0.75f);
     glTranslatef(x, y, z);
     glRotatef(-90 + angle, 0, 1, 0);
-    drawCircleXY(0, 0, 0, 4);
+    drawDisc(0, 0, 0, 4, level);
     glPopMatrix();
 }
 void drawGaugeContent(void){
-    int mph = static_cast<int>((velocity / 3.0) * 120);
+    int mph = static_cast<int>((drawnSim.velocity / 3.0) * 120);
 
     // Speed
     char mphText[10];
@@ -925,13 +1137,13 @@ void drawGaugeContent(void){
     glTranslatef(1.6, 11.5, 9.9);
     glScalef(0.015, 0.015, 0.015);
     glRotatef(180, 0.0, 1.0, 0.0);
-    writeStrokeString(GLUT_STROKE_ROMAN, mphText);
+    drawStrokeText(hudText, GLUT_STROKE_ROMAN, mphText);
     glPopMatrix();
     glPushMatrix();
     glTranslatef(0.9, 13.5, 9.9);
     glScalef(0.005, 0.005, 0.005);
     glRotatef(180, 0.0, 1.0, 0.0);
-    writeStrokeString(GLUT_STROKE_ROMAN, "SPEED");
+    drawStrokeText(hudText, GLUT_STROKE_ROMAN, "SPEED");
     glPopMatrix();
     
     // Lap Time
@@ -941,20 +1153,27 @@ void drawGaugeContent(void){
     glTranslatef(-4, 11, 9.9);
     glScalef(0.01, 0.01, 0.01);
     glRotatef(180, 0.0, 1.0, 0.0);
-    writeStrokeString(GLUT_STROKE_ROMAN, timeText);
+    drawStrokeText(hudText, GLUT_STROKE_ROMAN, timeText);
     glPopMatrix();
     
     glPushMatrix();
     glTranslatef(6, 11, 9.9);
     glScalef(0.01, 0.01, 0.01);
     glRotatef(180, 0.0, 1.0, 0.0);
-    glutStrokeCharacter(GLUT_STROKE_ROMAN, (velocity >= 0) ? 'D' : 'R');
+    drawStrokeText(hudText, GLUT_STROKE_ROMAN, (drawnSim.velocity >= 0) ? "D" : "R");
     glPopMatrix();
 }
 void drawRacecar(void){
+    PROFILE_GL_SCOPE("racecar");
+    if (!sphereVisible(drawnSim.meX, 5, drawnSim.meZ, 20)) { // The scaled car fits in a sphere of radius 20
+        updateHeadlights(); // The headlights still light what is in view
+        return;
+    }
+    int level = selectLod(drawnSim.meX, 5, drawnSim.meZ, 20);
+
     glPushMatrix();
-    glTranslatef(meX, 0.0f, meZ);
-    glRotatef(angleX, 0.0f, 1.0f, 0.0f);
+    glTranslatef(drawnSim.meX, 0.0f, drawnSim.meZ);
+    glRotatef(drawnSim.angleX, 0.0f, 1.0f, 0.0f);
     glScalef(0.4f, 0.4f, 0.4f);
     
     // Front and rear wings
@@ -974,7 +1193,7 @@ void drawRacecar(void){
     glColor3f(0.25, 0.25, 0.25);
     glPushMatrix();
     glTranslatef(0, 10, 0);
-    glutSolidSphere(5, 100, 100);
+    drawLodMesh(driverLod, level);
     glPopMatrix();
     
     glEnable(GL_BLEND);
@@ -982,24 +1201,24 @@ void drawRacecar(void){
     
     // Gauge cluster
     glColor4f(0, 0, 0, 0.5);
-    drawCircleXY(0, 10, 10.1, 5);
-    drawCircleXY(5, 10, 10.1, 3);
-    drawCircleXY(-5, 10, 10.1, 3);
+    drawDisc(0, 10, 10.1, 5, level);
+    drawDisc(5, 10, 10.1, 3, level);
+    drawDisc(-5, 10, 10.1, 3, level);
     
     // Steering wheel
     if(fpv){
         glColor4f(0, 0, 0, 1.0);
-        drawCircleXY(0, 10, 7, 5);
+        drawDisc(0, 10, 7, 5, level);
         glColor3f(1, 0, 0);
-        drawCircleXY(0, 10.1, 6.9, 4);
+        drawDisc(0, 10.1, 6.9, 4, level);
     }
     
     GLfloat mat_emission[] = {0.5f, 0.5f, 0.5f, 1.0f};
     glMaterialfv(GL_FRONT, GL_EMISSION, mat_emission);
     glColor4f(0.1, 0.1, 0.1, 0.5);
-    drawCircleXY(0, 10, 10.05, 4.9);
-    drawCircleXY(5, 10, 10, 2.9);
-    drawCircleXY(-5, 10, 10, 2.9);
+    drawDisc(0, 10, 10.05, 4.9, level);
+    drawDisc(5, 10, 10, 2.9, level);
+    drawDisc(-5, 10, 10, 2.9, level);
     GLfloat no_mat[] = {0.0f, 0.0f, 0.0f, 1.0f};
     glMaterialfv(GL_FRONT, GL_EMISSION, no_mat);
     glDisable(GL_BLEND);
@@ -1015,20 +1234,81 @@ void drawRacecar(void){
     drawTriangles(intakeTriangles, 2);
     
     // Wheels
-    drawWheel(-12.5, 5, 20, wheelAngle);    // Front left wheel
-    drawWheel(12.5, 5, 20, wheelAngle);     // Front right wheel
-    drawWheel(-12.5, 5, -30, 0);   // Rear left wheel
-    drawWheel(12.5, 5, -30, 0);    // Rear right wheel
-    drawCylinder(-12.5, 5, 20, 12.5, 5, 20, 1);
-    drawCylinder(-12.5, 5, -30, 12.5, 5, -30, 1);
+    drawWheel(-12.5, 5, 20, drawnSim.wheelAngle, level);    // Front left wheel
+    drawWheel(12.5, 5, 20, drawnSim.wheelAngle, level);     // Front right wheel
+    drawWheel(-12.5, 5, -30, 0, level);   // Rear left wheel
+    drawWheel(12.5, 5, -30, 0, level);    // Rear right wheel
+
+    // Axles, turned from +Y to +X
+    for (float axleZ : {20.0f, -30.0f}) {
+        glPushMatrix();
+        glTranslatef(-12.5, 5, axleZ);
+        glRotatef(-90, 0, 0, 1);
+        drawLodMesh(axleLod, level);
+        glPopMatrix();
+    }
     glPopMatrix();
     
     updateHeadlights();
 }
+// Translucent single-colour car at a ghost's pose; drawn after the opaque scene without writing depth
+void drawGhostCar(const GhostSample &pose) {
+    if (!sphereVisible(pose.x, 5, pose.z, 20)) return;
+    int level = selectLod(pose.x, 5, pose.z, 20);
+
+    glPushMatrix();
+    glTranslatef(pose.x, 0.0f, pose.z);
+    glRotatef(pose.heading, 0.0f, 1.0f, 0.0f);
+    glScalef(0.4f, 0.4f, 0.4f);
+    drawBoxFromCorners(-15, 0, 45, 15, 5, 35); // Front wing
+    drawBoxFromCorners(-15, 15, -35, 15, 20, -45); // Rear wing
+    drawBoxFromCorners(-5, 0, 15, 5, 10, -35); // Central body
+    drawBoxFromCorners(-15, 0, 5, 15, 10, -15); // Fenders
+    drawBoxFromCorners(-5, 10, -5, 5, 15, -15); // Behind cockpit
+    drawQuads(slantedQuads, 10);
+    drawTriangles(slantedTriangles, 6);
+    for (int i = 0; i < 4; i++) { // Wheels, front ones turned
+        float x = i % 2 ? 12.5 : -12.5, z = i < 2 ? 20 : -30;
+        glPushMatrix();
+        glTranslatef(x, 5, z);
+        glRotatef(90 + (i < 2 ? pose.wheelAngle : 0), 0.0f, 1.0f, 0.0f);
+        drawLodMesh(tireLod, level);
+        glPopMatrix();
+    }
+    glPopMatrix();
+}
+void drawGhosts() {
+    if (!showGhosts) return;
+    PROFILE_GL_SCOPE("ghosts");
+    // Ghosts wait at the line until the lap starts and stop when it ends
+    double lapSeconds = 0;
+    if (drawnSim.timerRunning) lapSeconds = drawnSim.time - drawnSim.lapStartTime;
+    else if (drawnSim.currentCheckpoint == checkpointsCount) lapSeconds = drawnSim.lapEndTime - drawnSim.lapStartTime;
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    for (int i = 0; i < ghostCount; i++) {
+        if (!ghosts[i].loaded()) continue;
+        if (i == 0) glColor4f(0.6, 0.8, 1.0, 0.4); // Best lap
+        else glColor4f(1.0, 1.0, 1.0, 0.25);
+        drawGhostCar(ghostPose(ghosts[i], lapSeconds));
+    }
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
+void drawParticleEffects() {
+    PROFILE_GL_SCOPE("particles");
+    drawParticles(particleRenderer, smoke, 40);
+    drawParticles(particleRenderer, sparks, 6);
+    drawParticles(particleRenderer, confetti, 10);
+}
 void drawMPHDial(float mph) {
     float gaugeHeight = 20.0f; // Height of the gauge
     int baseX = 10; // Base x position
-    int baseY = glutGet(GLUT_WINDOW_HEIGHT) - 30;
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    int baseY = viewport[3] - 30;
     glColor3f(1.0f, 1.0f, 1.0f);
     glBegin(GL_QUADS);
     glVertex2f(baseX, baseY);
@@ -1036,12 +1316,42 @@ void drawMPHDial(float mph) {
     glVertex2f(baseX + abs(mph), baseY + 20);
     glVertex2f(baseX, baseY + 20);
     glEnd();
-    drawText((velocity >= 0) ? "DRIVE" : "REVERSE", 10, 965);
+    countDraw(4);
+    drawText((drawnSim.velocity >= 0) ? "DRIVE" : "REVERSE", 10, 965);
+}
+
+// Profiler overlay: p50 and p99 per section over the last PROFILE_HISTORY frames
+void drawProfileOverlay() {
+    int y = 240;
+    char line[100];
+    sprintf(line, "%-15s %7s %6s | %7s %6s (ms)", "Section", "CPU p50", "p99", "GPU p50", "p99");
+    drawText(line, 10, y);
+    for (int s = 0; s < profileSectionCount(); ++s) {
+        ProfileStats cpu = profileStats(s), gpu = profileStats(s, true);
+        if (gpu.samples) {
+            sprintf(line, "%-15s %7.3f %6.3f | %7.3f %6.3f", profileSectionName(s), cpu.p50, cpu.p99, gpu.p50, gpu.p99);
+        } else {
+            sprintf(line, "%-15s %7.3f %6.3f |", profileSectionName(s), cpu.p50, cpu.p99);
+        }
+        drawText(line, 10, y += 16);
+    }
+}
+void writeProfileReports() {
+    if (profileFrameCount() == 0) return;
+    std::string csv = profilePath + ".csv", json = profilePath + ".json";
+    if (writeProfileCsv(csv.c_str()) && writeProfileJson(json.c_str())) {
+        cout << "Frame profile of the last " << std::min(profileFrameCount(), (long)PROFILE_HISTORY)
+             << " frames written to " << csv << " and " << json << endl;
+    }
 }
 
 // Drawing routine.
-void drawScene(void)
+void drawFrame(void)
 {
+    if (!offscreen) { // GLUT fonts need a GLUT window; without an atlas text is skipped
+        buildTextAtlas(hudText, {GLUT_BITMAP_9_BY_15, GLUT_BITMAP_TIMES_ROMAN_24, GLUT_STROKE_ROMAN}); // First frame only
+    }
+
     if(day) {
         glClearColor(0.53f, 0.81f, 0.92f, 1.0f);
     } else {
@@ -1056,16 +1366,14 @@ void drawScene(void)
 
     if (!gameStarted) {
         // Camera rotates around the origin at a radius of 200
-        baseCameraX = 300 * cos(cameraAngle);
-        baseCameraZ = 300 * sin(cameraAngle);
+        baseCameraX = 300 * cos(shown->cameraAngle);
+        baseCameraZ = 300 * sin(shown->cameraAngle);
         baseCameraY = 100;  // Fixed height above the origin
 
         targetX = 0;  // Looking at the origin
         targetY = 0;
         targetZ = 0;
 
-        cameraAngle += 0.005;  // Increment the angle for smooth rotation
-        
         setOrthographicProjection();
         renderCenteredText("OpenGL Racing Simulator");
         resetPerspectiveProjection();
@@ -1075,23 +1383,23 @@ void drawScene(void)
         float cameraHeight = fpv ? 10 : 50;   // Height above the car
         float sideOffset = 50.0f;     // Distance to the side of the car for side views
 
-        baseCameraX = meX - cameraDistance * sin(angleX * PI / 180);
-        baseCameraZ = meZ - cameraDistance * cos(angleX * PI / 180);
-        baseCameraY = meY + cameraHeight;
+        baseCameraX = drawnSim.meX - cameraDistance * sin(drawnSim.angleX * PI / 180);
+        baseCameraZ = drawnSim.meZ - cameraDistance * cos(drawnSim.angleX * PI / 180);
+        baseCameraY = drawnSim.meY + cameraHeight;
 
-        targetX = meX;  // Car's current position
-        targetY = meY + 10;
-        targetZ = meZ;
+        targetX = drawnSim.meX;  // Car's current position
+        targetY = drawnSim.meY + 10;
+        targetZ = drawnSim.meZ;
 
         if (lookBehind) {
-            baseCameraX = meX + cameraDistance * sin(angleX * PI / 180);
-            baseCameraZ = meZ + cameraDistance * cos(angleX * PI / 180);
+            baseCameraX = drawnSim.meX + cameraDistance * sin(drawnSim.angleX * PI / 180);
+            baseCameraZ = drawnSim.meZ + cameraDistance * cos(drawnSim.angleX * PI / 180);
         } else if (lookLeft) {
-            baseCameraX = meX + sideOffset * cos(angleX * PI / 180);
-            baseCameraZ = meZ - sideOffset * sin(angleX * PI / 180);
+            baseCameraX = drawnSim.meX + sideOffset * cos(drawnSim.angleX * PI / 180);
+            baseCameraZ = drawnSim.meZ - sideOffset * sin(drawnSim.angleX * PI / 180);
         } else if (lookRight) {
-            baseCameraX = meX - sideOffset * cos(angleX * PI / 180);
-            baseCameraZ = meZ + sideOffset * sin(angleX * PI / 180);
+            baseCameraX = drawnSim.meX - sideOffset * cos(drawnSim.angleX * PI / 180);
+            baseCameraZ = drawnSim.meZ + sideOffset * sin(drawnSim.angleX * PI / 180);
         }
     }
 
@@ -1099,6 +1407,8 @@ void drawScene(void)
     gluLookAt(baseCameraX, baseCameraY, baseCameraZ, // Camera position
               targetX, targetY, targetZ, // Look at point
               0.0f, 1.0f, 0.0f); // Up vector
+    beginLodFrame();
+    beginCullFrame();
 
     drawGrass();
     drawHill(-200, 0, 450, 90);
@@ -1111,10 +1421,11 @@ void drawScene(void)
     drawRacecar();
     if(day){drawSun();}
     else{drawMoon();}
+    drawGhosts();
+    drawParticleEffects();
     
-    if (timerRunning) {
-        int currentTime = glutGet(GLUT_ELAPSED_TIME);
-        currentLapTime = (currentTime - lapStartTime) / 1000.0f;
+    if (drawnSim.timerRunning) {
+        currentLapTime = drawnSim.time - drawnSim.lapStartTime;
         char currentLapTimeText[100];
         sprintf(currentLapTimeText, "Current Lap Time: %.2f seconds", currentLapTime);
         setOrthographicProjection();
@@ -1122,38 +1433,248 @@ void drawScene(void)
         resetPerspectiveProjection();
     }
 
-    if (currentCheckpoint > 6){
-        updateAndDrawConfetti(confettiCannon1);
-        updateAndDrawConfetti(confettiCannon2);
-        
+    if (drawnSim.currentCheckpoint == checkpointsCount){
         char lapTimeText[100]; // Buffer for lap time text
-        float lapTime = (lapEndTime - lapStartTime) / 1000.0f;
+        float lapTime = drawnSim.lapEndTime - drawnSim.lapStartTime;
         sprintf(lapTimeText, "Lap completed in %.2f seconds.", lapTime);
         setOrthographicProjection();  // Switch to 2D projection
         drawText(lapTimeText, 10, 50);  // Draw text on the screen
         drawText("Press 'r' to restart.", 10, 70);  // Draw text on the screen
         resetPerspectiveProjection();  // Switch back to your 3D projection
     }
+    if (showLodStats) {
+        setOrthographicProjection();
+        for (int level = 0; level < LOD_LEVELS; ++level) {
+            char lodText[100];
+            sprintf(lodText, "LOD %d: %ld objects, %ld triangles, %ld saved", level,
+                    lodCounters.objects[level], lodCounters.triangles[level], lodCounters.trianglesSaved[level]);
+            drawText(lodText, 10, 100 + 20 * level);
+        }
+        char cullText[100];
+        sprintf(cullText, "Culling %s: %ld visible, %ld culled", frustumCulling ? "on" : "off",
+                cullCounters.visible, cullCounters.culled);
+        drawText(cullText, 10, 100 + 20 * LOD_LEVELS);
+        char textureText[100];
+        sprintf(textureText, "Textures: %d, %zu KB resident", textureCount(), textureResidentBytes() / 1024);
+        drawText(textureText, 10, 120 + 20 * LOD_LEVELS);
+        const char *names[3] = {"Confetti", "Smoke", "Sparks"};
+        const ParticleSystem *systems[3] = {&confetti, &smoke, &sparks};
+        for (int i = 0; i < 3; i++) {
+            char particleText[100];
+            sprintf(particleText, "%s: %d live, %.2f ms update, %zu KB", names[i], systems[i]->count,
+                    systems[i]->updateMilliseconds, particleBytes(*systems[i]) / 1024);
+            drawText(particleText, 10, 140 + 20 * LOD_LEVELS + 20 * i);
+        }
+        resetPerspectiveProjection();
+    }
     if(!fpv){ // Third person view dials
         setOrthographicProjection();
-        float mph = velocity * 25;
+        float mph = drawnSim.velocity * 25;
         drawMPHDial(mph); // Draw the MPH dial
         resetPerspectiveProjection();
     }
-
+    if (showProfile) {
+        setOrthographicProjection();
+        drawProfileOverlay();
+        resetPerspectiveProjection();
+    }
+    {
+        PROFILE_GL_SCOPE("hud text");
+        drawQueuedText(hudText);
+    }
+}
+// Queue everything the scene needs beyond the track arrays. The loads run on
+// asset workers and never touch GL; nothing reads their results until sceneLoaded.
+void queueSceneAssets() {
+    sceneLoaded = false;
+    queueAsset("distance field", [] { bakeTrackDistanceField(fieldCellSize); });
+    // Track geometry never changes, so tessellate it once
+    queueAsset("track meshes", buildTrackMeshes, uploadTrackMeshes);
+    queueAsset("night floor", [] { buildNightFloorMesh(trackQuads, trackQuadsCount); }, uploadNightFloorMesh);
+    queueAsset("level-of-detail meshes", buildLodMeshes, uploadLodMeshes);
+    queueAsset("cloud impostors", bakeCloudImpostors, [] {
+        cloudImpostorTexture = cacheTexture("cloud impostors", cloudImpostorImage, false);
+        cloudImpostorImage = Image();
+    });
+    queueAsset("grass texture", [] { if (loadBmp(grassImage, GRASS_TEXTURE_PATH)) buildMipChain(grassImage); }, [] {
+        // Mipmapped for the distant grass and hills; drawn untextured if it failed to load
+        if (!grassImage.levels.empty()) textureGrass = cacheTexture(GRASS_TEXTURE_PATH, grassImage);
+        grassImage = Image();
+    });
+}
+// Hand finished assets to GL within this frame's budget. Call with the main
+// window's context current; returns true once the whole scene is loaded.
+bool pumpSceneAssets() {
+    if (sceneLoaded) return true;
+    if (pumpAssetUploads(ASSET_UPLOAD_BUDGET) > 0) return false;
+    sceneLoaded = true;
+
+    cout << "Scene loaded after " << millisecondsSinceStart() << " ms on " << assetWorkerCount() << " asset threads" << endl;
+    for (const AssetTiming &timing : assetTimings()) {
+        cout << "\t" << timing.name << ": " << timing.loadMilliseconds << " ms, upload " << timing.uploadMilliseconds << " ms" << endl;
+    }
+    const DistanceField &field = trackDistanceField();
+    cout << "Track distance field: " << field.cols << "x" << field.rows << " samples, "
+         << field.bytes() / 1024 << " KB, baked in " << field.bakeMilliseconds << " ms" << endl;
+    cout << "Track mesh: " << trackFloorMesh.triangleCount() + trackMesh.triangleCount() << " triangles ("
+         << nightFloorMesh.triangleCount() << " in the night floor), "
+         << (trackFloorMesh.bytes() + trackMesh.bytes() + nightFloorMesh.bytes()) / 1024 << " KB in "
+         << (trackMesh.buffer ? "vertex buffers" : "display lists") << endl;
+    cout << "Textures: " << textureCount() << ", " << textureResidentBytes() / 1024 << " KB resident" << endl;
+    return true;
+}
+// Load the scene without waiting frames, for the benchmarks
+void finishSceneAssets() {
+    finishAssets();
+    pumpSceneAssets();
+}
+// Main window frame while loading: the sky colour and a notice
+void drawLoadingFrame() {
+    buildTextAtlas(hudText, {GLUT_BITMAP_9_BY_15, GLUT_BITMAP_TIMES_ROMAN_24, GLUT_STROKE_ROMAN}); // First frame only
+    if (day) glClearColor(0.53f, 0.81f, 0.92f, 1.0f);
+    else glClearColor(0.05, 0.05, 0.25, 1.0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    setOrthographicProjection();
+    renderCenteredText("Loading...");
+    resetPerspectiveProjection();
+    drawQueuedText(hudText);
     glutSwapBuffers();
 }
+// Spawn the particles the simulation asked for and move every particle on by
+// the ticks run since the last frame, so effects keep the simulation's pace
+void updateParticleEffects() {
+    PROFILE_SCOPE("particles");
+    for (const ParticleBurst *burst; (burst = burstQueue.peek()); burstQueue.pop()) {
+        float heading = burst->heading * PI / 180, c = cos(heading), s = sin(heading);
+        switch (burst->effect) {
+            case CONFETTI_EFFECT:
+                emitParticles(confetti, confettiCannons[0], burst->amount / 2);
+                emitParticles(confetti, confettiCannons[1], burst->amount / 2);
+                break;
+            case SMOKE_EFFECT: // From both rear wheels
+                for (int side = -1; side <= 1; side += 2) {
+                    ParticleEmitter &wheel = smoke.emitters[smokeEmitter];
+                    wheel.position[0] = burst->x + side * 5 * c - 12 * s;
+                    wheel.position[2] = burst->z - side * 5 * s - 12 * c;
+                    emitParticles(smoke, smokeEmitter, burst->amount / 2);
+                }
+                break;
+            case SPARK_EFFECT: { // From the nose
+                ParticleEmitter &nose = sparks.emitters[sparkEmitter];
+                nose.position[0] = burst->x + 18 * s;
+                nose.position[2] = burst->z + 18 * c;
+                emitParticles(sparks, sparkEmitter, burst->amount);
+                break;
+            }
+        }
+    }
+    float dt = (shown->ticks - particleTicks) * tickSeconds;
+    particleTicks = shown->ticks;
+    updateParticles(confetti, dt);
+    updateParticles(smoke, dt);
+    updateParticles(sparks, dt);
+}
+// Take the newest snapshot from the simulation thread and the car pose to draw
+// from it: one tick behind real time, so between its two ticks
+void showSimulation() {
+    simSnapshots.update();
+    shown = &simSnapshots.readSlot();
+    float t = (millisecondsSinceStart() / 1000 - shown->tickTime) / tickSeconds;
+    drawnSim = interpolateSimulation(shown->previous, shown->current, std::min(std::max(t, 0.0f), 1.0f));
+    updateParticleEffects();
+    if (shown->lapsCompleted != lapsShown) {
+        lapsShown = shown->lapsCompleted;
+        currentLightRow = -1;
+    }
+    if (shown->bestLapsSaved != bestLapsMapped) {
+        bestLapsMapped = shown->bestLapsSaved;
+        mapGhost(ghosts[0], bestLapPath.c_str());
+    }
+}
+void drawScene(void)
+{
+    if (!pumpSceneAssets()) {
+        drawLoadingFrame();
+        return;
+    }
+    showSimulation();
+    {
+        PROFILE_GL_SCOPE("frame");
+        drawFrame();
+    }
+    if (offscreen) glFinish(); // Nothing to present; wait so the frame is fully rendered
+    else glutSwapBuffers();
+    collectGpuProfile();
+    endProfileFrame();
+}
 /*\ -------------------------- \*/
 
 
 /*\ - Initialization Routine - \*/
 void updateLightSequence(int value) {
+    if (offscreen) { // No GLUT timers: show every row lit
+        currentLightRow = 3;
+        return;
+    }
     if (currentLightRow < 3) {
         currentLightRow++;
         glutPostRedisplay();  // Request a redraw to update the scene
         glutTimerFunc(lightUpdateTime, updateLightSequence, 0);  // Continue the timer
     }
 }
+// Particle systems and their pooled emitters. Confetti keeps the per-tick
+// tuning of the reference tick, converted to seconds.
+void setupParticleEffects() {
+    initParticles(confetti, MAX_PARTICLES);
+    confetti.gravity = -0.1f / (SIM_TICK_SECONDS * SIM_TICK_SECONDS);
+    confetti.floor = -1;
+    ParticleEmitter cannon;
+    cannon.velocity[1] = 6.125f / SIM_TICK_SECONDS;
+    cannon.velocitySpread[0] = cannon.velocitySpread[2] = 0.5f / SIM_TICK_SECONDS;
+    cannon.velocitySpread[1] = 3.625f / SIM_TICK_SECONDS;
+    cannon.colorSpread = 1; // Any colour
+    cannon.life = 60; // Until it lands
+    float cannonPositions[2][3] = {{200, 0, 100}, {280, 10, 100}};
+    for (int i = 0; i < 2; i++) {
+        std::copy(cannonPositions[i], cannonPositions[i] + 3, cannon.position);
+        confettiCannons[i] = addEmitter(confetti, cannon);
+    }
+
+    initParticles(smoke, MAX_PARTICLES);
+    smoke.gravity = 15; // Warm smoke rises
+    smoke.drag = 1.5;
+    smoke.fade = true;
+    ParticleEmitter puff;
+    puff.position[1] = 2;
+    puff.positionSpread = 1.5;
+    puff.velocity[1] = 10;
+    puff.velocitySpread[0] = puff.velocitySpread[2] = 12;
+    puff.velocitySpread[1] = 5;
+    puff.color[0] = puff.color[1] = puff.color[2] = 0.75;
+    puff.alpha = 0.5;
+    puff.life = 1.2;
+    puff.lifeSpread = 0.4;
+    smokeEmitter = addEmitter(smoke, puff);
+
+    initParticles(sparks, MAX_PARTICLES);
+    sparks.gravity = -300;
+    sparks.drag = 1;
+    sparks.floor = 0;
+    sparks.fade = true;
+    ParticleEmitter spark;
+    spark.position[1] = 3;
+    spark.positionSpread = 2;
+    spark.velocity[1] = 60;
+    spark.velocitySpread[0] = spark.velocitySpread[2] = 120;
+    spark.velocitySpread[1] = 60;
+    spark.color[0] = 1;
+    spark.color[1] = 0.75;
+    spark.color[2] = 0.3;
+    spark.colorSpread = 0.15;
+    spark.life = 0.4;
+    spark.lifeSpread = 0.2;
+    sparkEmitter = addEmitter(sparks, spark);
+}
 void setup(void)
 {
     glEnable(GL_DEPTH_TEST); // Enable depth testing.
@@ -1186,8 +1707,20 @@ void setup(void)
     currentLightRow = -1;
     updateLightSequence(0);
     
-    initConfetti(confettiCannon1, 200.0, 0.0, 100);
-    initConfetti(confettiCannon2, 280.0, 10.0, 100);
+    setupParticleEffects();
+    generateExtraClouds();
+    
+    // Cars slide along walls instead of bouncing straight back; the field is baked with the scene assets
+    sim.params.distanceFieldCollision = true;
+
+    // Trees listed in the track file
+    trees.clear();
+    for (int i = 0; i < trackTreesCount; ++i) {
+        const float *tree = trackTrees[i];
+        trees.emplace_back(tree[0], tree[1], tree[2], tree[3], tree[4]);
+    }
+
+    queueSceneAssets();
 }
 void startScreenResize(int w, int h) {
     // Avoid division by zero
@@ -1212,101 +1745,8 @@ void resize(int w, int h)
     gluPerspective(120,1,1,1000);
     glMatrixMode(GL_MODELVIEW);
 }
-void updateCheckpoint(float x, float z) {
-    switch (currentCheckpoint) {
-        case 0:
-            if (z > 0 && !timerRunning) {
-                currentCheckpoint++;
-                lapStartTime = glutGet(GLUT_ELAPSED_TIME);
-                timerRunning = true;
-                std::cout << "Lap started!\n";
-            }
-            break;
-        case 1:
-            if (z > 280) currentCheckpoint++;
-            break;
-        case 2:
-            if (x < -200) currentCheckpoint++;
-            break;
-        case 3:
-            if (z < -320) currentCheckpoint++;
-            break;
-        case 4:
-            if (x > 0 && z > 60) currentCheckpoint++;
-            break;
-        case 5:
-            if (x > 240) currentCheckpoint++;
-            break;
-        case 6:
-            if (z > 0) {
-                currentCheckpoint++;
-                timerRunning = false;
-                lapEndTime = glutGet(GLUT_ELAPSED_TIME);
-                float lapTime = (lapEndTime - lapStartTime) / 1000.0f;
-                std::cout << "Lap completed in " << lapTime << " seconds.\n";
-                currentLightRow = -1;
-            }
-            break;
-    }
-}
-
-int isInsideAnyBox(float x, float z, float boxes[][6], int numBoxes) {
-    float radius = 5.0f; // Radius of the circle around the point
-
-    for (int i = 0; i < numBoxes; i++) {
-        // Calculate expanded bounds to include the circle's radius
-        float x1 = fmin(boxes[i][0], boxes[i][3]) - radius;
-        float x2 = fmax(boxes[i][0], boxes[i][3]) + radius;
-        float z1 = fmin(boxes[i][2], boxes[i][5]) - radius;
-        float z2 = fmax(boxes[i][2], boxes[i][5]) + radius;
-
-        // Check if the center of the circle is within the expanded bounds
-        if (x >= x1 && x <= x2 && z >= z1 && z <= z2) {
-            return 1; // Center of the circle is within an expanded box
-        }
-    }
-    return 0; // Center of the circle is not inside any expanded box
-}
-bool isWithinAngles(float x, float z, float cx, float cz, float startAngle, float endAngle) {
-    float angleToPoint = atan2(z - cz, x - cx) * 180.0 / PI;
-    if (angleToPoint < 0) angleToPoint += 360;
-
-    float normalizedStartAngle = fmod(startAngle, 360);
-    float normalizedEndAngle = fmod(endAngle, 360);
-
-    if (normalizedStartAngle <= normalizedEndAngle) {
-        return angleToPoint >= normalizedStartAngle && angleToPoint <= normalizedEndAngle;
-    } else {
-        return angleToPoint >= normalizedStartAngle || angleToPoint <= normalizedEndAngle;
-    }
-}
-// Function to determine if a point (x, z) intersects with any annular or partial ring barrier.
-int isInsideAnyCircle(float x, float z, float circles[][7], int numCircles) {
-    float carRadius = 6;
-    for (int i = 0; i < numCircles; i++) {
-        // Circle center and radii
-        float cx = circles[i][0];
-        float cz = circles[i][2];
-        float outerRadius = circles[i][3] + carRadius;
-        float innerRadius = circles[i][4] - carRadius;
-        float startAngle = circles[i][5] * 180.0 / PI;
-        float endAngle = circles[i][6] * 180.0 / PI;
-        float outerRadiusSquared = outerRadius * outerRadius;
-        float innerRadiusSquared = innerRadius * innerRadius;
-
-        // Calculate squared distance from point to circle center
-        float dx = x - cx;
-        float dz = z - cz;
-        float distSquared = dx * dx + dz * dz;
-
-        // Check if within annular range
-        if (distSquared <= outerRadiusSquared && distSquared >= innerRadiusSquared && isWithinAngles(x, z, cx, cz, startAngle, endAngle)) {
-            return 1; // Collision detected
-        }
-    }
-    return 0; // No collision detected
-}
-void update(int value) {
+// Sunlight by day, headlights at night (in the automatic headlight mode)
+void updateLights() {
     if(day){
         glEnable(GL_LIGHT0);  // Sunlight
         if (headlightMode == 3) {
@@ -1320,90 +1760,145 @@ void update(int value) {
             glEnable(GL_LIGHT2);  // Enable right headlight
         }
     }
-    
-    if (keyStates['w']) { // Accelerate
-        velocity += acceleration;
-        if (velocity > maxVelocity) velocity = maxVelocity;
-    } else if (keyStates['s'] && lapStartTime) { // Decelerate
-        velocity -= deceleration;
-        if (velocity < -maxVelocity) velocity = -maxVelocity;
-    } else { // Automatic deceleration when no keys are pressed
-        if (velocity > 0) velocity -= deceleration;
-        else if (velocity < 0) velocity += deceleration;
-        if (std::abs(velocity) < deceleration) velocity = 0; // Stop completely if speed is very low
-    }
-
-    // Define the maximum wheel angle
-    const float maxWheelAngle = 25.0f;
-    const float wheelAngleStep = 5.0f;  // Adjust this to control the smoothness
-
-    // Handling turning while moving
-    if (velocity != 0 && lapStartTime) {
-        float turnAdjustment = (fabs(velocity) <= 2) ?
-            (turnSpeed * 0.5 * (velocity > 0 ? 1 : -1)) :
-            (turnSpeed * (1.0 - 0.5 * (fabs(velocity) / maxVelocity)) * (velocity > 0 ? 1 : -1));
-
-        if (keyStates['a']) { // Turn left
-            angleX += turnAdjustment;
-            wheelAngle += wheelAngle < maxWheelAngle ? wheelAngleStep : 0;
-            wheelAngle = std::min(wheelAngle, maxWheelAngle); // Ensure it does not exceed max angle
-        } else if (keyStates['d']) { // Turn right
-            angleX -= turnAdjustment;
-            wheelAngle -= wheelAngle > -maxWheelAngle ? wheelAngleStep : 0;
-            wheelAngle = std::max(wheelAngle, -maxWheelAngle); // Ensure it does not exceed min angle
-        }
-    } else {
-        // If neither 'a' nor 'd' is pressed or the car is not moving, gradually return the wheel to the center
-        if (wheelAngle < 0) {
-            wheelAngle += wheelAngleStep;
-            wheelAngle = std::min(wheelAngle, 0.0f); // Do not overshoot the center
-        } else if (wheelAngle > 0) {
-            wheelAngle -= wheelAngleStep;
-            wheelAngle = std::max(wheelAngle, 0.0f); // Do not overshoot the center
-        }
+}
+// Keep the lap just completed as the best-lap ghost if it beats the saved one.
+// The renderer maps the new file when it sees bestLapsSaved change.
+void saveBestLap() {
+    double lapSeconds = sim.lapEndTime - sim.lapStartTime;
+    if (bestLapSeconds <= lapSeconds) return;
+    if (saveGhost(bestLapPath.c_str(), ghostRecorder, lapSeconds)) {
+        bestLapSeconds = lapSeconds;
+        bestLapsSaved++;
+        std::cout << "New best lap, saved to " << bestLapPath << "\n";
     }
-
-    // Check if the proposed new position is within any barriers and then update position
-    float proposedMeZ = meZ + velocity * cos(angleX * PI / 180);
-    float proposedMeX = meX + velocity * sin(angleX * PI / 180);
-    if (!isInsideAnyBox(proposedMeX, proposedMeZ, axisBarriers, axisBarriersCount) &&
-        !isInsideAnyCircle(proposedMeX, proposedMeZ, curveBarriers, curveBarriersCount)) {
-        // If not inside any box, update the position
-        meZ = proposedMeZ;
-        meX = proposedMeX;
-    } else {
-        // Collision detected, apply bounce back
-        float elasticity = 0.25; // Coefficient of how much velocity is preserved after the bounce
-        velocity = -velocity * elasticity; // Reverse and reduce velocity
-
-        // Recalculate position using adjusted velocity
-        meZ += velocity * cos(angleX * PI / 180);
-        meX += velocity * sin(angleX * PI / 180);
+}
+// Move the clouds, teapots and start screen camera on by ticks reference ticks
+void animateScenery(float ticks) {
+    cloudDrift = fmod(cloudDrift + cloudSpeed * ticks, 50); // Every cloud moves alike, so only the drift is kept
+    teapotRotationAngle += 2.0f * ticks; // 2 degrees per reference tick
+    if (teapotRotationAngle > 360.0f) {
+        teapotRotationAngle -= 360.0f; // Wrap around at 360 degrees
     }
-    
-    if(!useIdleFunc){
-        for (int i = 0; i < 6; i++) {
-            // Update cloud position
-            cloudPositions[i].z += cloudSpeed;
-
-            // Reset cloud position if it moves too far
-            if (cloudPositions[i].z > 25.0) {
-                cloudPositions[i].z = -25.0;
-            }
-        }
-        teapotRotationAngle += 2.0f; // Increase the angle by 2 degrees each frame
-        if (teapotRotationAngle > 360.0f) {
-            teapotRotationAngle -= 360.0f; // Wrap around at 360 degrees
-        }
+    cameraAngle += 0.005f * ticks; // Start screen camera circling the track
+}
+// Ask the render thread for particles around the car
+void sendBurst(int effect, float amount) {
+    ParticleBurst burst = {effect, sim.meX, sim.meZ, sim.angleX, amount};
+    burstQueue.push(burst); // Dropped if the renderer has fallen far behind
+}
+// One fixed simulation step of tickSeconds
+void tick() {
+    PROFILE_SCOPE("update");
+    previousSim = sim;
+    int events = stepSimulation(sim, heldInputs, tickSeconds);
+    ticksRun++;
+    if (recordingPath) recordTick(inputRecording, inputFlags(heldInputs), events, sim);
+    if (recordGhostTick(ghostRecorder, sim, events)) saveBestLap();
+    if (events & SIM_EVENT_LAP_STARTED) {
+        std::cout << "Lap started!\n";
+    }
+    if (events & SIM_EVENT_LAP_COMPLETED) {
+        std::cout << "Lap completed in " << sim.lapEndTime - sim.lapStartTime << " seconds.\n";
+        lapsCompleted++;
+        sendBurst(CONFETTI_EFFECT, 2 * confettiPerCannon);
     }
+    if (events & SIM_EVENT_COLLISION) { // Sparks for the impact and for scraping along the wall
+        float impact = std::fabs(sim.velocity - previousSim.velocity);
+        sendBurst(SPARK_EFFECT, 100 * impact + 1000 * tickSeconds * std::fabs(sim.velocity) / sim.params.maxVelocity);
+    }
+    bool steering = heldInputs.steerLeft || heldInputs.steerRight;
+    if (sim.lapStarted && ((steering && std::fabs(sim.velocity) > 2) || (heldInputs.brake && sim.velocity > 1))) {
+        sendBurst(SMOKE_EFFECT, 300 * tickSeconds); // Tyres skidding
+    }
+    animateScenery(tickSeconds / SIM_TICK_SECONDS);
+}
+// Copy the simulation's state into the triple buffer for the renderer
+void publishSimulation(double tickTime) {
+    SimSnapshot &snapshot = simSnapshots.writeSlot();
+    snapshot.previous = previousSim;
+    snapshot.current = sim;
+    snapshot.tickTime = tickTime;
+    snapshot.ticks = ticksRun;
+    snapshot.cloudDrift = cloudDrift;
+    snapshot.teapotAngle = teapotRotationAngle;
+    snapshot.cameraAngle = cameraAngle;
+    snapshot.lapsCompleted = lapsCompleted;
+    snapshot.bestLapsSaved = bestLapsSaved;
+    simSnapshots.publish();
+}
+// Apply the inputs sent up to time, oldest first
+void receiveInputs(double time) {
+    for (const InputMessage *message; (message = inputQueue.peek()) && message->time <= time; inputQueue.pop()) {
+        heldInputs = inputsFromFlags(message->heldFlags);
+        if (!message->event) continue;
+        applyInputEvent(sim, message->event, inputSettings);
+        previousSim = sim; // Resets and steps jump; do not draw the car sliding there
+        if (recordingPath) recordEvent(inputRecording, message->event);
+    }
+}
+// Tick on a fixed schedule, sleeping between ticks. Inputs are applied to the
+// tick their timestamps fall before, even when catching up after a stall.
+void runSimulation() {
+    double due = millisecondsSinceStart() / 1000;
+    while (simulationRunning.load(std::memory_order_relaxed)) {
+        receiveInputs(due);
+        tick();
+        publishSimulation(due);
+        due += tickSeconds;
+        double now = millisecondsSinceStart() / 1000;
+        if (now - due > MAX_TICK_BACKLOG) due = now; // Too far behind: skip ahead, so the game slows down
+        else if (due > now) std::this_thread::sleep_for(std::chrono::duration<double>(due - now));
+    }
+}
+// The w/a/s/d keys as the GLUT thread sees them
+SimInputs heldKeys() {
+    SimInputs inputs;
+    inputs.accelerate = keyStates['w'];
+    inputs.brake = keyStates['s'];
+    inputs.steerLeft = keyStates['a'];
+    inputs.steerRight = keyStates['d'];
+    return inputs;
+}
+void stopSimulationThread() {
+    if (!simulationThread.joinable()) return;
+    simulationRunning = false;
+    simulationThread.join();
+}
+void startSimulationThread() {
+    heldInputs = heldKeys(); // Keys pressed while loading
+    publishSimulation(millisecondsSinceStart() / 1000);
+    simulationRunning = true;
+    simulationThread = std::thread(runSimulation);
+    atexit(stopSimulationThread); // Before the recording is saved and static destructors run
+}
+void update(int value) {
+    if (!sceneLoaded) { // The simulation needs the distance field
+        glutTimerFunc(16, update, 0);
+        return;
+    }
+    if (!simulationThread.joinable()) startSimulationThread();
+    updateLights();
     glutPostRedisplay(); // Redraw the scene
     glutTimerFunc(16, update, 0); // Re-register timer for continuous updates
-    
-    updateCheckpoint(meX, meZ);
+}
+// Send the held keys and a discrete input (or 0) to the simulation thread
+void sendInput(int event) {
+    if (!sceneLoaded) return; // Collision needs the distance field; held keys are read again when the thread starts
+    InputMessage message = {millisecondsSinceStart() / 1000, inputFlags(heldKeys()), event};
+    if (!inputQueue.push(message)) std::cerr << "Input queue full; input dropped" << std::endl;
+}
+void saveInputRecording() {
+    endRecording(inputRecording, sim);
+    if (saveRecording(inputRecording, recordingPath)) {
+        cout << "Recorded " << inputRecording.ticks << " ticks (" << inputRecording.bits.size() << " bytes of input) to "
+             << recordingPath << "; check it with headless --replay " << recordingPath << endl;
+    }
 }
 void keyInput(unsigned char key, int x, int y) {
     key = tolower(key);
+    bool pressed = !keyStates[key]; // Not a key repeat
     keyStates[key] = true;
+    if (pressed && (key == 'w' || key == 'a' || key == 's' || key == 'd')) sendInput(0);
     switch (key) {
         case 'c':
             lookBehind = true;
@@ -1417,6 +1912,18 @@ void keyInput(unsigned char key, int x, int y) {
         case 'x':
             fpv = !fpv;
             break;
+        case 'l':
+            showLodStats = !showLodStats;
+            break;
+        case 'f':
+            frustumCulling = !frustumCulling;
+            break;
+        case 'p':
+            showProfile = !showProfile;
+            break;
+        case 'g':
+            showGhosts = !showGhosts;
+            break;
         case 'h':
             headlightMode = (headlightMode + 1) % 4;  // Cycle through headlights
             if(headlightMode){
@@ -1429,11 +1936,8 @@ void keyInput(unsigned char key, int x, int y) {
             angleY = (headlightMode == 1 ? -1.25 : -1);
             break;
         case 'r':
-            meX=240, meY=0, meZ=-40, angleX=0, angleY = (headlightMode == 2 ? -1 : -1.25);
-            currentCheckpoint = 0;
-            timerRunning = false;
-            lapStartTime = 0;
-            velocity = 0;
+            sendInput(INPUT_RESET);
+            angleY = (headlightMode == 2 ? -1 : -1.25);
             currentLightRow = -1;
             updateLightSequence(0);
             break;
@@ -1448,7 +1952,9 @@ void keyUp(unsigned char key, int x, int y) {
     key = tolower(key);
     keyStates[key] = false;
     if (key == 'a' || key == 'd') {
-        wheelAngle = 0.0f;
+        sendInput(INPUT_CENTER_WHEEL);
+    } else if (key == 'w' || key == 's') {
+        sendInput(0);
     }
     if (key == 'c') {
         lookBehind = false;
@@ -1463,19 +1969,16 @@ void specialKeyInput(int key, int x, int y)
     switch(key){
         // For clipping through walls
         case GLUT_KEY_UP:
-            meZ=meZ+stepsize*cos(angleX*PI/180);
-            meX=meX+stepsize*sin(angleX*PI/180);
+            sendInput(INPUT_STEP_FORWARD);
             break;
         case GLUT_KEY_DOWN:
-            meZ=meZ-stepsize*cos(angleX*PI/180);
-            meX=meX-stepsize*sin(angleX*PI/180);
+            sendInput(INPUT_STEP_BACK);
             break;
         case GLUT_KEY_RIGHT:
-            angleX-=turnsize;
+            sendInput(INPUT_TURN_RIGHT);
             break;
         case GLUT_KEY_LEFT:
-            angleX+=turnsize;
-            
+            sendInput(INPUT_TURN_LEFT);
             break;
     }
     glutPostRedisplay();
@@ -1504,7 +2007,24 @@ void createMenu() {
     // Attach the menu to the right mouse button
     glutAttachMenu(GLUT_RIGHT_BUTTON);
 }
+void switchToMainGame() {
+    
+    glutSetWindow(startWindow);
+    glutHideWindow();
+
+    glutSetWindow(mainWindow);
+    glutShowWindow();
+    
+    sendInput(INPUT_RESET);
+    angleY = (headlightMode == 2 ? -1 : -1.25);
+    currentLightRow = -1;
+    updateLightSequence(0);
+    gameStarted = true;
+    
+    glutPostRedisplay();
+}
 void globalTimer(int value) {
+    if (startWhenLoaded && sceneLoaded && !gameStarted) switchToMainGame(); // Start Game was clicked while loading
     if(!gameStarted){
         // Post redisplay for the start window
         glutSetWindow(startWindow);
@@ -1518,20 +2038,8 @@ void globalTimer(int value) {
         glutTimerFunc(16, globalTimer, 0); // Approximately 60 times per second
     }
 }
+// Draw as often as the display allows; the simulation still ticks at its fixed rate
 void idle() {
-    for (int i = 0; i < 6; i++) {
-        // Update cloud position
-        cloudPositions[i].z += cloudSpeed;
-
-        // Reset cloud position if it moves too far
-        if (cloudPositions[i].z > 25.0) {
-            cloudPositions[i].z = -25.0;
-        }
-    }
-    teapotRotationAngle += 2.0f; // Increase the angle by 2 degrees each frame
-    if (teapotRotationAngle > 360.0f) {
-        teapotRotationAngle -= 360.0f; // Wrap around at 360 degrees
-    }
     glutPostRedisplay();
 }
 // Routine to output interaction instructions to the C++ window.
@@ -1555,6 +2063,10 @@ void printInteraction(void) {
 
     cout << "Miscellaneous Controls:" << endl;
     cout << "\tH - Cycle through different headlight modes: Auto, Off, Low, High." << endl;
+    cout << "\tL - Show level-of-detail, culling, texture and particle counters." << endl;
+    cout << "\tF - Toggle view-frustum culling." << endl;
+    cout << "\tP - Show the frame profiler: p50 and p99 CPU and GPU milliseconds per section." << endl;
+    cout << "\tG - Toggle the ghost cars of the best lap and of laps loaded with --ghost." << endl;
 
     cout << "Stepping Controls (stepping through walls):" << endl;
     cout << "\tArrow Up - Move forward relative to the vehicle’s current direction." << endl;
@@ -1570,11 +2082,8 @@ void printInteraction(void) {
 }
 
 void drawButtonLabel(const char* text, int x, int y, int width) {
-    glColor3f(1.0, 1.0, 1.0);  // Text color
-    glRasterPos2i(x + (width - glutBitmapLength(GLUT_BITMAP_8_BY_13, (const unsigned char*)text)) / 2, y - 7);
-    for (const char* c = text; *c != '\0'; c++) {
-        glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
-    }
+    float color[3] = {1.0, 1.0, 1.0};  // Text color
+    queueText(startScreenText, GLUT_BITMAP_8_BY_13, text, x + (width - (int)textWidth(startScreenText, GLUT_BITMAP_8_BY_13, text)) / 2, y - 7, color);
 }
 void drawStartScreen() {
     glMatrixMode(GL_PROJECTION);
@@ -1584,15 +2093,12 @@ void drawStartScreen() {
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
 
+    buildTextAtlas(startScreenText, {GLUT_BITMAP_HELVETICA_18, GLUT_BITMAP_8_BY_13}); // First frame only
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glClearColor(0.0, 0.0, 0.0, 1.0);  // Set the background color
 
-    glColor3f(1.0, 1.0, 1.0);  // Set text color to white
-    glRasterPos2i(175, 800);  // Position the main title text
-    const char* title = "Select Mode";
-    for (const char* c = title; *c != '\0'; c++) {
-        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
-    }
+    float white[3] = {1.0, 1.0, 1.0};  // Text color
+    queueText(startScreenText, GLUT_BITMAP_HELVETICA_18, "Select Mode", 175, 800, white);  // Main title
 
     int startX = 150;
     int buttonWidth = 200;
@@ -1611,28 +2117,14 @@ void drawStartScreen() {
     // Play Game Button
     glColor3f(1.0, 0.0, 0.0);
     glRecti(startX, 400, startX + buttonWidth, 450);
-    drawButtonLabel("Start Game", startX, 425, buttonWidth);
+    drawButtonLabel(sceneLoaded || !startWhenLoaded ? "Start Game" : "Loading...", startX, 425, buttonWidth);
 
+    drawQueuedText(startScreenText);
     glutSwapBuffers();
-}
-void switchToMainGame() {
-    
-    glutSetWindow(startWindow);
-    glutHideWindow();
-
-    glutSetWindow(mainWindow);
-    glutShowWindow();
-    
-    meX=240, meY=0, meZ=-40, angleX=0, angleY = (headlightMode == 2 ? -1 : -1.25);
-    currentCheckpoint = 0;
-    timerRunning = false;
-    lapStartTime = 0;
-    velocity = 0;
-    currentLightRow = -1;
-    updateLightSequence(0);
-    gameStarted = true;
-    
-    glutPostRedisplay();
+    if (!firstFrameShown) {
+        firstFrameShown = true;
+        cout << "First frame after " << millisecondsSinceStart() << " ms" << endl;
+    }
 }
 void mouseInput(int button, int state, int x, int y) {
     if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN) {
@@ -1658,7 +2150,8 @@ void mouseInput(int button, int state, int x, int y) {
                 isNightSelected = true;
                 day = false;
             } else if (y > 400 * (windowHeight / 1000.0) && y < (400 * (windowHeight / 1000.0) + buttonHeight)) {
-                switchToMainGame();
+                if (sceneLoaded) switchToMainGame();
+                else startWhenLoaded = true; // Started by globalTimer()
             }
             glutPostRedisplay();
         }
@@ -1679,9 +2172,8 @@ void createMainWindow() {
     glutInitWindowPosition(0, 0);
     mainWindow = glutCreateWindow("OpenGL Racing Simulator");
 
-    setup();  // Setup your OpenGL context and initial states for the main game
+    setup();  // Setup your OpenGL context and initial states for the main game; assets load in the background
     createMenu();
-    loadGrassTexture();
 
     glutDisplayFunc(drawScene);
     glutReshapeFunc(resize);
@@ -1696,15 +2188,338 @@ void createMainWindow() {
     }
 }
 /*\ -------------------------- \*/
+
+
+/*\ ---- Render Benchmark ---- \*/
+// Camera path for the benchmark: roughly one lap along the middle of the track, as (x, z)
+float benchPath[][2] = {
+    {240, -120}, {240, 140}, {180, 230}, {150, 300}, {110, 355}, {50, 355}, {10, 300}, {-40, 240},
+    {-200, 240}, {-240, 180}, {-240, -340}, {-180, -360}, {-40, -320}, {0, -240}, {0, -150},
+    {-100, 0}, {0, 100}, {70, 70}, {160, 160}, {240, 140}
+};
+int benchPathCount = sizeof(benchPath) / sizeof(benchPath[0]);
+
+// Put the car a fraction t of the way along the path, facing along it
+void placeOnBenchPath(float t) {
+    float length = 0;
+    for (int i = 1; i < benchPathCount; i++) {
+        length += hypot(benchPath[i][0] - benchPath[i - 1][0], benchPath[i][1] - benchPath[i - 1][1]);
+    }
+    float distance = t * length;
+    for (int i = 1; i < benchPathCount; i++) {
+        float dx = benchPath[i][0] - benchPath[i - 1][0], dz = benchPath[i][1] - benchPath[i - 1][1];
+        float segment = hypot(dx, dz);
+        if (distance <= segment || i == benchPathCount - 1) {
+            float f = std::min(distance / segment, 1.0f);
+            sim.meX = benchPath[i - 1][0] + f * dx;
+            sim.meZ = benchPath[i - 1][1] + f * dz;
+            sim.angleX = atan2(dx, dz) * 180 / PI;
+            return;
+        }
+        distance -= segment;
+    }
+}
+// Draw frames along the camera path in an offscreen context and report the throughput.
+// The path is driven four times: day chase camera, day FPV, night chase camera, night FPV.
+void runRenderBenchmark(int frames, int width, int height) {
+    if (!createOffscreenContext(width, height)) exit(1);
+    offscreen = true;
+    cout << "Renderer: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")" << endl;
+    setup();
+    finishSceneAssets();
+    resize(width, height);
+    gameStarted = true;
+    sim.velocity = 2; // Shown on the speed gauge
+
+    std::vector<double> frameMilliseconds;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = -1; frame < frames; frame++) { // Frame -1 is an untimed warm-up
+        int pass = std::max(frame, 0) * 4 / frames;
+        day = pass < 2;
+        fpv = pass % 2 == 1;
+        placeOnBenchPath(std::max(frame, 0) * 4.0f / frames - pass);
+        previousSim = sim; // Posed directly, so there is nothing to interpolate
+        teapotRotationAngle = fmod(std::max(frame, 0) * 2.0f, 360.0f); // Before publishing: drawScene() reads the snapshot
+        publishSimulation(millisecondsSinceStart() / 1000);
+        updateLights();
+
+        auto frameStart = std::chrono::steady_clock::now();
+        drawScene();
+        auto frameEnd = std::chrono::steady_clock::now();
+        if (frame < 0) {
+            start = frameEnd;
+            drawCounters = DrawCounters();
+            continue;
+        }
+        frameMilliseconds.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::sort(frameMilliseconds.begin(), frameMilliseconds.end());
+
+    cout << "Frames: " << frames << " at " << width << "x" << height << endl;
+    cout << "Wall time: " << seconds << " s" << endl;
+    cout << "Frames per second: " << frames / seconds << endl;
+    cout << "Frame time p50: " << frameMilliseconds[frames / 2] << " ms, p99: "
+         << frameMilliseconds[std::min(frames - 1, frames * 99 / 100)] << " ms" << endl;
+    cout << "Draw calls per frame: " << drawCounters.drawCalls / frames << endl;
+    cout << "Vertices per frame: " << drawCounters.vertices / frames << endl;
+    ProfileStats cloudCpu = profileStats(profileSection("clouds")), cloudGpu = profileStats(profileSection("clouds"), true);
+    cout << "Clouds: " << cloudPositions.size() << ", p50 " << cloudCpu.p50 << " ms CPU";
+    if (cloudGpu.samples) cout << ", " << cloudGpu.p50 << " ms GPU";
+    cout << " per frame" << endl;
+    releaseParticleRenderer(particleRenderer);
+    releaseTextures();
+    destroyOffscreenContext();
+}
+/*\ -------------------------- \*/
+
+
+/*\ ---- Track Scaling Benchmark ---- \*/
+volatile long benchHits = 0; // Keeps the timed queries from being optimised away
+
+// Time count queries at the (x, z) pairs in points; returns nanoseconds per query
+template <typename Query>
+double nanosecondsPerQuery(const std::vector<float> &points, int count, Query query) {
+    long hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) hits += query(points[i * 2], points[i * 2 + 1]);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    benchHits += hits;
+    return seconds * 1e9 / count;
+}
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+// Generate tracks from a few dozen pieces up to maxPieces (x4 each step) and
+// measure collision build and query cost, mesh build time and memory per size
+void runTrackBenchmark(int maxPieces) {
+    const int queries = 1 << 20;               // Per indexed query kind
+    const long bruteBudget = 1L << 27;         // Barrier tests for the brute-force queries per size
+    if (!createOffscreenContext(64, 64)) exit(1);
+    offscreen = true;
+
+    printf("%8s %8s %8s | %8s %9s %9s %9s %10s | %8s %8s %8s %8s %9s | %8s %9s %9s %8s %9s\n",
+           "pieces", "barriers", "gen ms", "grid ms", "grid KB", "field ms", "field MB", "field cell",
+           "grid ns", "sweep ns", "field ns", "brute ns", "track KB",
+           "mesh ms", "mesh KB", "triangles", "night ms", "night KB");
+    std::vector<float> points(queries * 2);
+    for (int pieces = 32; pieces <= maxPieces; pieces *= 4) {
+        TrackBuilder built;
+        auto start = std::chrono::steady_clock::now();
+        generateTrack(built, pieces);
+        double generateMilliseconds = millisecondsSince(start);
+        if (!setTrack(built)) exit(1);
+        int barriers = axisBarriersCount + curveBarriersCount;
+        size_t trackBytes = sizeof(float) * (axisBarriersCount * 6 + curveBarriersCount * 7 + trackQuadsCount * 15 +
+                                             trackCurvesCount * 7 + trackTreesCount * 5 + checkpointsCount * 4);
+
+        // Query points spread over the barriers' extent
+        float minX = INFINITY, minZ = INFINITY, maxX = -INFINITY, maxZ = -INFINITY;
+        for (int i = 0; i < axisBarriersCount; i++) {
+            minX = std::min(minX, std::min(axisBarriers[i][0], axisBarriers[i][3]));
+            maxX = std::max(maxX, std::max(axisBarriers[i][0], axisBarriers[i][3]));
+            minZ = std::min(minZ, std::min(axisBarriers[i][2], axisBarriers[i][5]));
+            maxZ = std::max(maxZ, std::max(axisBarriers[i][2], axisBarriers[i][5]));
+        }
+        for (int i = 0; i < curveBarriersCount; i++) {
+            float radius = std::max(curveBarriers[i][3], curveBarriers[i][4]);
+            minX = std::min(minX, curveBarriers[i][0] - radius);
+            maxX = std::max(maxX, curveBarriers[i][0] + radius);
+            minZ = std::min(minZ, curveBarriers[i][2] - radius);
+            maxZ = std::max(maxZ, curveBarriers[i][2] + radius);
+        }
+        srand(1);
+        for (int i = 0; i < queries; i++) {
+            points[i * 2] = minX + (maxX - minX) * (rand() / (float)RAND_MAX);
+            points[i * 2 + 1] = minZ + (maxZ - minZ) * (rand() / (float)RAND_MAX);
+        }
+
+        BarrierGrid grid;
+        start = std::chrono::steady_clock::now();
+        buildBarrierGrid(grid, axisBarriers, axisBarriersCount, curveBarriers, curveBarriersCount);
+        double gridMilliseconds = millisecondsSince(start);
+        double gridNs = nanosecondsPerQuery(points, queries, [&grid](float x, float z) {
+            return gridCollides(grid, x, z);
+        });
+        double sweepNs = nanosecondsPerQuery(points, queries, [&grid](float x, float z) {
+            float hitT;
+            return gridSweep(grid, x, z, x + 7, z + 7, &hitT);
+        });
+        int bruteQueries = (int)std::max(256L, std::min((long)queries, bruteBudget / barriers));
+        double bruteNs = nanosecondsPerQuery(points, bruteQueries, [](float x, float z) {
+            return isInsideAnyBox(x, z, axisBarriers, axisBarriersCount) || isInsideAnyCircle(x, z, curveBarriers, curveBarriersCount);
+        });
+
+        // The field is dense over the whole extent, so past its sample limit it coarsens instead
+        DistanceField field;
+        bakeDistanceField(field, axisBarriers, axisBarriersCount, curveBarriers, curveBarriersCount);
+        double fieldNs = nanosecondsPerQuery(points, queries, [&field](float x, float z) {
+            return sampleDistanceField(field, x, z) < 0;
+        });
+
+        start = std::chrono::steady_clock::now();
+        buildTrackMeshes();
+        uploadTrackMeshes();
+        double meshMilliseconds = millisecondsSince(start);
+        size_t meshBytes = trackFloorMesh.bytes() + trackMesh.bytes();
+        int triangles = trackFloorMesh.triangleCount() + trackMesh.triangleCount();
+        printf("%8d %8d %8.2f | %8.2f %9zu %9.2f %9.1f %10g | %8.1f %8.1f %8.1f %8.1f %9zu | %8.2f %9zu %9d",
+               pieces, barriers, generateMilliseconds, gridMilliseconds, grid.bytes() / 1024,
+               field.bakeMilliseconds, field.bytes() / 1048576.0, field.cellSize,
+               gridNs, sweepNs, fieldNs, bruteNs, trackBytes / 1024,
+               meshMilliseconds, meshBytes / 1024, triangles);
+        // The night floor columns, or dashes past its size cap
+        if (trackQuadsCount <= MAX_NIGHT_FLOOR_QUADS) {
+            start = std::chrono::steady_clock::now();
+            buildNightFloorMesh(trackQuads, trackQuadsCount);
+            uploadMesh(nightFloorMesh);
+            printf(" %8.2f %9zu\n", millisecondsSince(start), nightFloorMesh.bytes() / 1024);
+        } else {
+            printf(" %8s %9s\n", "-", "-");
+        }
+        releaseMesh(nightFloorMesh);
+        nightFloorMesh = Mesh();
+        fflush(stdout);
+    }
+    releaseMesh(trackFloorMesh);
+    releaseMesh(trackMesh);
+    destroyOffscreenContext();
+}
+/*\ -------------------------- \*/
+
+
+/*\ ---- Particle Benchmark ---- \*/
+// Keep count particles alive from one fountain and time their update, and their
+// upload and drawing, over frames frames at 60 frames per second
+void runParticleBenchmark(int count, int frames) {
+    const int size = 512;
+    const float dt = 1.0f / 60;
+    if (!createOffscreenContext(size, size)) exit(1);
+    offscreen = true;
+    cout << "Renderer: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")" << endl;
+    glViewport(0, 0, size, size);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(60, 1, 1, 2000);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    gluLookAt(0, 100, 400, 0, 100, 0, 0, 1, 0);
+    glEnable(GL_DEPTH_TEST);
+
+    ParticleSystem fountain;
+    initParticles(fountain, count);
+    fountain.gravity = -100;
+    fountain.fade = true;
+    ParticleEmitter spout;
+    spout.positionSpread = 5;
+    spout.velocity[1] = 100;
+    spout.velocitySpread[0] = spout.velocitySpread[2] = 30;
+    spout.velocitySpread[1] = 20;
+    spout.colorSpread = 1;
+    spout.life = 2;
+    spout.lifeSpread = 0.5;
+    spout.rate = count / spout.life; // The pool limit caps the rest
+    addEmitter(fountain, spout);
+    for (float t = 0; t < spout.life + spout.lifeSpread; t += dt) updateParticles(fountain, dt); // Fill to a steady state
+
+    ParticleRenderer renderer;
+    std::vector<double> updateMilliseconds, drawMilliseconds;
+    long live = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        updateParticles(fountain, dt);
+        updateMilliseconds.push_back(fountain.updateMilliseconds);
+        live += fountain.count;
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        auto start = std::chrono::steady_clock::now();
+        drawParticles(renderer, fountain, 4);
+        glFinish();
+        drawMilliseconds.push_back(millisecondsSince(start));
+    }
+    std::sort(updateMilliseconds.begin(), updateMilliseconds.end());
+    std::sort(drawMilliseconds.begin(), drawMilliseconds.end());
+
+    cout << "Live particles: " << live / frames << " of " << count << endl;
+    cout << "SIMD width: " << particleSimdWidth() << " floats" << endl;
+    cout << "Update p50: " << updateMilliseconds[frames / 2] << " ms, p99: "
+         << updateMilliseconds[std::min(frames - 1, frames * 99 / 100)] << " ms" << endl;
+    cout << "Upload and draw p50: " << drawMilliseconds[frames / 2] << " ms, p99: "
+         << drawMilliseconds[std::min(frames - 1, frames * 99 / 100)] << " ms" << endl;
+    cout << "Pool: " << particleBytes(fountain) / 1048576.0 << " MB, streamed per frame: "
+         << live / frames * sizeof(ParticleVertex) / 1048576.0 << " MB" << endl;
+    releaseParticleRenderer(renderer);
+    releaseTextures();
+    destroyOffscreenContext();
+}
+/*\ -------------------------- \*/
 // Main routine.
 int main(int argc, char **argv)
 {
+    profilingEnabled = true; // For the overlay and the benchmarks; reports are only saved with --profile
+    const char *trackPath = DEFAULT_TRACK_PATH;
+    int benchFrames = 0, benchWidth = 1000, benchHeight = 1000, benchPieces = 0, benchParticles = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--track-bench") == 0) { // --track-bench [maxPieces]
+            benchPieces = 131072;
+            if (i + 1 < argc && isdigit(argv[i + 1][0])) benchPieces = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--particle-bench") == 0) { // --particle-bench [count]
+            benchParticles = MAX_PARTICLES;
+            if (i + 1 < argc && isdigit(argv[i + 1][0])) benchParticles = std::max(atoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--bench") == 0) { // --bench [frames [width height]]
+            benchFrames = 1000;
+            if (i + 1 < argc && isdigit(argv[i + 1][0])) benchFrames = std::max(atoi(argv[++i]), 1);
+            if (i + 2 < argc && isdigit(argv[i + 1][0])) {
+                benchWidth = atoi(argv[++i]);
+                benchHeight = atoi(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--profile") == 0) { // --profile [path]
+            profilePath = "profile";
+            if (i + 1 < argc && argv[i + 1][0] != '-') profilePath = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--track") == 0) {
+            trackPath = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--tick-rate") == 0) {
+            tickSeconds = 1.0f / std::max(atof(argv[++i]), 1.0);
+        } else if (i + 1 < argc && strcmp(argv[i], "--clouds") == 0) {
+            cloudCount = std::max(atoi(argv[++i]), 0);
+        } else if (i + 1 < argc && strcmp(argv[i], "--confetti") == 0) {
+            confettiPerCannon = std::max(atoi(argv[++i]), 0);
+        } else if (i + 1 < argc && strcmp(argv[i], "--record") == 0) {
+            recordingPath = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--ghost") == 0 && ghostCount < MAX_GHOSTS) {
+            if (mapGhost(ghosts[ghostCount], argv[++i])) ghostCount++;
+            else cout << "Could not load ghost lap " << argv[i] << endl;
+        }
+    }
+    if (!profilePath.empty()) atexit(writeProfileReports);
+    if (benchPieces) {
+        runTrackBenchmark(benchPieces);
+        return 0;
+    }
+    if (benchParticles) {
+        runParticleBenchmark(benchParticles, 120);
+        return 0;
+    }
+    if (!loadTrack(trackPath)) return 1;
+    if (benchFrames) {
+        runRenderBenchmark(benchFrames, benchWidth, benchHeight);
+        return 0;
+    }
+    bestLapPath = trackPath;
+    size_t name = bestLapPath.find_last_of('/') + 1, extension = bestLapPath.find_last_of('.');
+    if (extension != std::string::npos && extension > name) bestLapPath.erase(extension);
+    bestLapPath += ".ghost";
+    if (mapGhost(ghosts[0], bestLapPath.c_str())) bestLapSeconds = ghosts[0].header->lapSeconds; // Best lap of earlier runs
+    ghostRecorder.tickSeconds = tickSeconds;
     printInteraction();
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
     
     createStartWindow();
     createMainWindow();
+    if (recordingPath) { // From the state setup() left, before the first tick
+        beginRecording(inputRecording, sim, fieldCellSize, inputSettings);
+        inputRecording.tickSeconds = tickSeconds;
+        atexit(saveInputRecording);
+    }
 
     glutMainLoop();
     return 0;
@@ -0,0 +1,289 @@
+/******************************************
+*
+* Input recording and replay.
+*
+*******************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+
+#include "replay.h"
+#include "track.h"
+
+#define RECORDING_MAGIC "RREC"
+#define RECORDING_VERSION 2
+
+void applyInputEvent(SimState &state, int event, const InputSettings &settings) {
+    float step = settings.stepSize;
+    switch (event) {
+        case INPUT_RESET:
+            resetSimulation(state);
+            break;
+        case INPUT_STEP_BACK:
+            step = -step;
+            // Fall through
+        case INPUT_STEP_FORWARD: {
+            float dirX = sin(state.angleX * PI / 180), dirZ = cos(state.angleX * PI / 180);
+            float hitT;
+            if (!settings.clipThroughWalls && sweepTrack(state.meX, state.meZ, state.meX + step * dirX, state.meZ + step * dirZ, &hitT)) {
+                step *= hitT * 0.99f; // Stop just short of the wall
+            }
+            state.meZ = state.meZ + step * dirZ;
+            state.meX = state.meX + step * dirX;
+            break;
+        }
+        case INPUT_TURN_LEFT:
+            state.angleX += settings.turnSize;
+            break;
+        case INPUT_TURN_RIGHT:
+            state.angleX -= settings.turnSize;
+            break;
+        case INPUT_CENTER_WHEEL:
+            state.wheelAngle = 0.0f;
+            break;
+    }
+}
+
+int inputFlags(const SimInputs &inputs) {
+    return (inputs.accelerate ? SIM_INPUT_ACCELERATE : 0) | (inputs.brake ? SIM_INPUT_BRAKE : 0) |
+           (inputs.steerLeft ? SIM_INPUT_STEER_LEFT : 0) | (inputs.steerRight ? SIM_INPUT_STEER_RIGHT : 0);
+}
+SimInputs inputsFromFlags(int flags) {
+    SimInputs inputs;
+    inputs.accelerate = flags & SIM_INPUT_ACCELERATE;
+    inputs.brake = flags & SIM_INPUT_BRAKE;
+    inputs.steerLeft = flags & SIM_INPUT_STEER_LEFT;
+    inputs.steerRight = flags & SIM_INPUT_STEER_RIGHT;
+    return inputs;
+}
+
+/*\ ---- Bit stream ---- \*/
+// Least significant bit first within each byte
+static void writeBits(InputRecording &recording, uint64_t value, int count) {
+    for (int i = 0; i < count; ++i, ++recording.bitCount) {
+        if (recording.bitCount % 8 == 0) recording.bits.push_back(0);
+        if (value >> i & 1) recording.bits.back() |= 1 << (recording.bitCount % 8);
+    }
+}
+// Elias gamma code of value >= 1: as many zeros as value has bits after the first, then value from its top bit down
+static void writeGamma(InputRecording &recording, uint64_t value) {
+    int length = 0;
+    while (value >> (length + 1)) ++length;
+    writeBits(recording, 0, length);
+    for (int i = length; i >= 0; --i) writeBits(recording, value >> i & 1, 1);
+}
+
+// Reads past the end give zeros and set failed instead of leaving the buffer
+struct BitReader {
+    const uint8_t *bits;
+    uint64_t count, position;
+    bool failed;
+    bool done() const { return position >= count; }
+    int bit() {
+        if (done()) {
+            failed = true;
+            return 0;
+        }
+        int value = bits[position / 8] >> (position % 8) & 1;
+        ++position;
+        return value;
+    }
+    uint64_t read(int count) {
+        uint64_t value = 0;
+        for (int i = 0; i < count; ++i) value |= (uint64_t)bit() << i;
+        return value;
+    }
+    // 0 on failure: a prefix that runs off the end or is too long for 64 bits
+    uint64_t gamma() {
+        int length = 0;
+        while (bit() == 0) {
+            if (failed || ++length > 63) {
+                failed = true;
+                return 0;
+            }
+        }
+        uint64_t value = 1;
+        for (int i = 0; i < length; ++i) value = value << 1 | bit();
+        return failed ? 0 : value;
+    }
+};
+
+/*\ ---- Recording ---- \*/
+void beginRecording(InputRecording &recording, const SimState &state, float fieldCellSize, const InputSettings &settings) {
+    recording = InputRecording();
+    recording.fieldCellSize = state.params.distanceFieldCollision ? fieldCellSize : 0;
+    recording.settings = settings;
+    recording.start = state;
+}
+void recordEvent(InputRecording &recording, int event) {
+    recording.pending.push_back(event);
+}
+// An entry for the tick about to run: held keys from now on and the discrete inputs before it
+static void writeEntry(InputRecording &recording, long tick, int heldFlags) {
+    writeGamma(recording, tick - recording.lastEntryTick);
+    writeBits(recording, heldFlags, 4);
+    for (int event : recording.pending) writeBits(recording, event, INPUT_EVENT_BITS);
+    writeBits(recording, 0, INPUT_EVENT_BITS);
+    recording.pending.clear();
+    recording.held = heldFlags;
+    recording.lastEntryTick = tick;
+}
+void recordTick(InputRecording &recording, int heldFlags, int simEvents, const SimState &state) {
+    if (heldFlags != recording.held || !recording.pending.empty()) writeEntry(recording, recording.ticks, heldFlags);
+    recording.ticks++;
+    if (simEvents & SIM_EVENT_LAP_COMPLETED) recording.lapTimes.push_back(state.lapEndTime - state.lapStartTime);
+}
+void endRecording(InputRecording &recording, const SimState &state) {
+    // Inputs after the last tick still moved the car
+    if (!recording.pending.empty()) writeEntry(recording, recording.ticks, recording.held);
+    recording.end = state;
+}
+
+/*\ ---- File format ---- \*/
+// Little-endian dump of the fields, in this order
+template <typename T> static void put(FILE *file, T value) {
+    fwrite(&value, sizeof(T), 1, file);
+}
+template <typename T> static bool get(FILE *file, T &value) {
+    return fread(&value, sizeof(T), 1, file) == 1;
+}
+static void putState(FILE *file, const SimState &state) {
+    put(file, state.meX); put(file, state.meY); put(file, state.meZ);
+    put(file, state.angleX); put(file, state.velocity); put(file, state.wheelAngle);
+    put(file, (int32_t)state.currentCheckpoint);
+    put(file, (uint8_t)state.timerRunning); put(file, (uint8_t)state.lapStarted);
+    put(file, state.time); put(file, state.lapStartTime); put(file, state.lapEndTime);
+}
+static bool getState(FILE *file, SimState &state) {
+    int32_t checkpoint;
+    uint8_t timerRunning, lapStarted;
+    bool ok = get(file, state.meX) && get(file, state.meY) && get(file, state.meZ) &&
+              get(file, state.angleX) && get(file, state.velocity) && get(file, state.wheelAngle) &&
+              get(file, checkpoint) && get(file, timerRunning) && get(file, lapStarted) &&
+              get(file, state.time) && get(file, state.lapStartTime) && get(file, state.lapEndTime);
+    state.currentCheckpoint = checkpoint;
+    state.timerRunning = timerRunning;
+    state.lapStarted = lapStarted;
+    return ok;
+}
+static void putParams(FILE *file, const SimParams &p) {
+    put(file, p.acceleration); put(file, p.deceleration); put(file, p.maxVelocity); put(file, p.turnSpeed);
+    put(file, p.maxWheelAngle); put(file, p.wheelAngleStep); put(file, p.elasticity);
+    put(file, (uint8_t)p.distanceFieldCollision); put(file, p.carRadius); put(file, (uint8_t)p.sweptCollision);
+}
+static bool getParams(FILE *file, SimParams &p) {
+    uint8_t field, swept;
+    bool ok = get(file, p.acceleration) && get(file, p.deceleration) && get(file, p.maxVelocity) && get(file, p.turnSpeed) &&
+              get(file, p.maxWheelAngle) && get(file, p.wheelAngleStep) && get(file, p.elasticity) &&
+              get(file, field) && get(file, p.carRadius) && get(file, swept);
+    p.distanceFieldCollision = field;
+    p.sweptCollision = swept;
+    return ok;
+}
+
+bool saveRecording(const InputRecording &recording, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+    fwrite(RECORDING_MAGIC, 1, 4, file);
+    put(file, (uint32_t)RECORDING_VERSION);
+    put(file, recording.tickSeconds);
+    put(file, recording.fieldCellSize);
+    put(file, recording.settings.stepSize); put(file, recording.settings.turnSize);
+    put(file, (uint8_t)recording.settings.clipThroughWalls);
+    putParams(file, recording.start.params);
+    putState(file, recording.start);
+    putState(file, recording.end);
+    put(file, (int64_t)recording.ticks);
+    put(file, (int32_t)recording.lapTimes.size());
+    for (double lapTime : recording.lapTimes) put(file, lapTime);
+    put(file, recording.bitCount);
+    fwrite(recording.bits.data(), 1, recording.bits.size(), file);
+    return fclose(file) == 0;
+}
+// Bytes between the read position and the end of the file
+static uint64_t bytesLeft(FILE *file) {
+    long position = ftell(file);
+    if (position < 0 || fseek(file, 0, SEEK_END) != 0) return 0;
+    long size = ftell(file);
+    fseek(file, position, SEEK_SET);
+    return size > position ? size - position : 0;
+}
+// Walks every entry so replay never runs off the stream: each code must be
+// complete and no entry may fall after the last tick
+static bool validStream(const InputRecording &recording) {
+    BitReader reader = {recording.bits.data(), recording.bitCount, 0, false};
+    long tick = -1;
+    while (!reader.done()) {
+        uint64_t gap = reader.gamma();
+        if (reader.failed || gap > (uint64_t)(recording.ticks - tick)) return false;
+        tick += (long)gap;
+        reader.read(4);
+        while (reader.read(INPUT_EVENT_BITS)) {}
+        if (reader.failed) return false;
+    }
+    return true;
+}
+bool loadRecording(InputRecording &recording, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+    recording = InputRecording();
+    char magic[4];
+    uint32_t version = 0;
+    uint8_t clip = 0;
+    int64_t ticks = 0;
+    int32_t laps = 0;
+    bool ok = fread(magic, 1, 4, file) == 4 && memcmp(magic, RECORDING_MAGIC, 4) == 0 &&
+              get(file, version) && version == RECORDING_VERSION &&
+              get(file, recording.tickSeconds) && get(file, recording.fieldCellSize) &&
+              get(file, recording.settings.stepSize) && get(file, recording.settings.turnSize) && get(file, clip) &&
+              getParams(file, recording.start.params) && getState(file, recording.start) && getState(file, recording.end) &&
+              get(file, ticks) && ticks >= 0 && get(file, laps) && laps >= 0 &&
+              (uint64_t)laps <= bytesLeft(file) / sizeof(double);
+    if (ok) {
+        recording.settings.clipThroughWalls = clip;
+        recording.end.params = recording.start.params;
+        recording.ticks = ticks;
+        recording.lapTimes.resize(laps);
+        for (int i = 0; ok && i < laps; ++i) ok = get(file, recording.lapTimes[i]);
+    }
+    // The sizes come from the file, so check them against it before allocating
+    ok = ok && get(file, recording.bitCount) && recording.bitCount <= bytesLeft(file) * 8;
+    if (ok) {
+        recording.bits.resize((recording.bitCount + 7) / 8);
+        ok = fread(recording.bits.data(), 1, recording.bits.size(), file) == recording.bits.size() && validStream(recording);
+    }
+    fclose(file);
+    return ok;
+}
+
+/*\ ---- Replay ---- \*/
+ReplayResult replayRecording(const InputRecording &recording) {
+    ReplayResult result;
+    SimState &state = result.state;
+    state = recording.start;
+    if (state.params.distanceFieldCollision) bakeTrackDistanceField(recording.fieldCellSize);
+
+    auto start = std::chrono::steady_clock::now();
+    BitReader reader = {recording.bits.data(), recording.bitCount, 0, false};
+    long nextEntry = reader.done() ? -1 : (long)reader.gamma() - 1;
+    SimInputs inputs;
+    for (long tick = 0; tick <= recording.ticks; ++tick) {
+        if (tick == nextEntry) {
+            inputs = inputsFromFlags((int)reader.read(4));
+            while (int event = (int)reader.read(INPUT_EVENT_BITS)) applyInputEvent(state, event, recording.settings);
+            nextEntry = reader.done() ? -1 : tick + (long)reader.gamma();
+        }
+        if (tick == recording.ticks) break; // Only inputs after the last tick
+        if (stepSimulation(state, inputs, recording.tickSeconds) & SIM_EVENT_LAP_COMPLETED) {
+            result.lapTimes.push_back(state.lapEndTime - state.lapStartTime);
+        }
+    }
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const SimState &end = recording.end;
+    result.matches = !reader.failed && state.meX == end.meX && state.meZ == end.meZ && state.angleX == end.angleX &&
+                     result.lapTimes == recording.lapTimes;
+    return result;
+}
@@ -0,0 +1,82 @@
+/******************************************
+*
+* Input recording and replay. Every tick's held keys and the discrete
+* inputs between ticks (reset, arrow-key steps, wheel centring) are
+* bit-packed into a log as the game runs. Replaying the log steps the
+* simulation from the recorded start state as fast as the CPU allows and
+* checks that it ends exactly where the recording did. No GL/GLUT
+* dependencies.
+*
+*******************************************/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <vector>
+#include <cstdint>
+
+#include "simulation.h"
+
+// Discrete inputs, applied between ticks in the order they happened
+#define INPUT_RESET         1  // R: back to the start line
+#define INPUT_STEP_FORWARD  2  // Arrow keys: move or turn outside the physics
+#define INPUT_STEP_BACK     3
+#define INPUT_TURN_LEFT     4
+#define INPUT_TURN_RIGHT    5
+#define INPUT_CENTER_WHEEL  6  // A or D released
+#define INPUT_EVENT_BITS    3
+
+// How the discrete inputs move the car; saved with each recording
+struct InputSettings {
+    float stepSize = 5.0f, turnSize = 10.0f;  // Arrow-key step and turn
+    bool clipThroughWalls = true;  // Arrow-key steps pass through barriers; false stops them at the first wall
+};
+
+void applyInputEvent(SimState &state, int event, const InputSettings &settings);
+
+// Held keys as SIM_INPUT_* flags and back
+int inputFlags(const SimInputs &inputs);
+SimInputs inputsFromFlags(int flags);
+
+// A recording. The bit stream holds one entry per tick on which the held keys
+// changed or discrete inputs arrived: the ticks since the previous entry
+// (Elias gamma code), the 4 held-key bits, then each discrete input in
+// INPUT_EVENT_BITS bits ending with a 0. Ticks in between repeat the held keys,
+// so an hour of driving takes a few kilobytes.
+struct InputRecording {
+    float tickSeconds = SIM_TICK_SECONDS;
+    float fieldCellSize = 0;  // Distance field resolution when params.distanceFieldCollision is set
+    InputSettings settings;
+    SimState start, end;      // Before the first tick and after the last
+    std::vector<double> lapTimes;  // Seconds, of each lap completed while recording
+    long ticks = 0;
+    std::vector<uint8_t> bits;
+    uint64_t bitCount = 0;
+
+    // Recorder state
+    int held = 0;
+    long lastEntryTick = -1;
+    std::vector<int> pending;  // Discrete inputs since the last tick
+};
+
+void beginRecording(InputRecording &recording, const SimState &state, float fieldCellSize, const InputSettings &settings);
+void recordEvent(InputRecording &recording, int event);
+// After each tick: the held keys it used, the SIM_EVENT_* flags it returned and the state it left
+void recordTick(InputRecording &recording, int heldFlags, int simEvents, const SimState &state);
+void endRecording(InputRecording &recording, const SimState &state);
+
+bool saveRecording(const InputRecording &recording, const char *path);
+// Fails on a truncated or corrupt file as well as on one that cannot be read
+bool loadRecording(InputRecording &recording, const char *path);
+
+struct ReplayResult {
+    SimState state;
+    std::vector<double> lapTimes;
+    double milliseconds = 0;  // Replay time, without the distance field bake
+    bool matches = false;     // Position, heading and every lap time identical to the recording
+};
+
+// Bakes the recorded distance field if needed, then steps through every tick
+ReplayResult replayRecording(const InputRecording &recording);
+
+#endif
@@ -0,0 +1,131 @@
+/******************************************
+*
+* Annular sector collision kernel: a squared-radius test first, then
+* cross products against the arc's end rays instead of atan2.
+*
+* isWithinAngles() converts atan2 to degrees with PI = 3.14159 and wraps
+* negative angles by adding 360, so a degree threshold does not sit on one
+* geometric ray: it lands at slightly different angles for points above
+* and below the circle's centre. Each threshold is therefore stored as one
+* ray per half-plane, which reproduces those comparisons with cross products.
+*
+*******************************************/
+
+#include <cmath>
+
+#include "sector.h"
+#include "simd.h"
+#include "track.h"
+
+// Ray for "angle >= radians" (or "angle <= radians" when before is set) among
+// atan2 results in [low, high]
+static void thresholdRay(double radians, double low, double high, bool before, float &rayX, float &rayZ, float &bias) {
+    bool always = before ? radians >= high : radians <= low;
+    bool never = before ? radians < low : radians > high;
+    if (always || never) {
+        rayX = rayZ = 0;
+        bias = always ? 1 : -1;
+    } else {
+        // angle <= radians is the mirror test of angle >= radians
+        rayX = before ? -cos(radians) : cos(radians);
+        rayZ = before ? -sin(radians) : sin(radians);
+        bias = 0;
+    }
+}
+// Both rays for one normalised degree threshold
+static void buildThreshold(SectorThresholds &t, int i, float degrees, bool before) {
+    // Upper half-plane: atan2 in [0, pi] maps to degrees directly.
+    // Lower half-plane: atan2 in (-pi, 0) maps to degrees + 360.
+    double upper = degrees * PI / 180.0;
+    thresholdRay(upper, 0, M_PI, before, t.upperX[i], t.upperZ[i], t.upperBias[i]);
+    thresholdRay((degrees - 360) * PI / 180.0, -M_PI, 0, before, t.lowerX[i], t.lowerZ[i], t.lowerBias[i]);
+
+    // A ray along the x axis cannot tell angle 0 from angle pi by cross product
+    // alone, so those thresholds also require the point to face the ray
+    t.facingX[i] = t.facingZ[i] = 0;
+    if ((before && upper == 0) || (!before && upper == M_PI)) {
+        t.facingX[i] = cos(upper);
+        t.facingZ[i] = sin(upper);
+    }
+}
+static void resizeThresholds(SectorThresholds &t, int n) {
+    t.upperX.assign(n, 0); t.upperZ.assign(n, 0); t.upperBias.assign(n, 0);
+    t.lowerX.assign(n, 0); t.lowerZ.assign(n, 0); t.lowerBias.assign(n, 0);
+    t.facingX.assign(n, 0); t.facingZ.assign(n, 0);
+}
+void buildSectorTable(SectorTable &table, float circles[][7], int numCircles, const int *order) {
+    float carRadius = 6; // As in isInsideCircle()
+    int padded = numCircles + SIMD_WIDTH; // Room for a full vector load at the last entry
+    table.count = numCircles;
+    table.cx.assign(padded, 0);
+    table.cz.assign(padded, 0);
+    table.outerSquared.assign(padded, -1);
+    table.innerSquared.assign(padded, 0);
+    resizeThresholds(table.start, padded);
+    resizeThresholds(table.end, padded);
+    table.wraps.assign(padded, 0);
+
+    for (int i = 0; i < numCircles; i++) {
+        const float *circle = circles[order ? order[i] : i];
+        float outerRadius = circle[3] + carRadius;
+        float innerRadius = circle[4] - carRadius;
+        table.cx[i] = circle[0];
+        table.cz[i] = circle[2];
+        table.outerSquared[i] = outerRadius * outerRadius;
+        table.innerSquared[i] = innerRadius * innerRadius;
+
+        // Same normalisation as isWithinAngles()
+        float startAngle = circle[5] * 180.0 / PI;
+        float endAngle = circle[6] * 180.0 / PI;
+        float normalizedStartAngle = fmod(startAngle, 360);
+        float normalizedEndAngle = fmod(endAngle, 360);
+        buildThreshold(table.start, i, normalizedStartAngle, false);
+        buildThreshold(table.end, i, normalizedEndAngle, true);
+        table.wraps[i] = normalizedStartAngle <= normalizedEndAngle ? 0 : -1;
+    }
+}
+// Evaluate one threshold for a point relative to the circle's centre; only
+// the ray of the point's half-plane is read
+static inline bool passes(const SectorThresholds &t, int i, float dx, float dz) {
+    if (dz >= 0) return t.upperX[i] * dz - t.upperZ[i] * dx + t.upperBias[i] >= 0 && t.facingX[i] * dx + t.facingZ[i] * dz >= 0;
+    return t.lowerX[i] * dz - t.lowerZ[i] * dx + t.lowerBias[i] >= 0;
+}
+bool sectorHit(const SectorTable &table, int i, float x, float z) {
+    float dx = x - table.cx[i];
+    float dz = z - table.cz[i];
+    float distSquared = dx * dx + dz * dz;
+    if (distSquared > table.outerSquared[i] || distSquared < table.innerSquared[i]) return false; // Most queries miss the ring
+
+    bool afterStart = passes(table.start, i, dx, dz);
+    if (table.wraps[i]) return afterStart || passes(table.end, i, dx, dz);
+    return afterStart && passes(table.end, i, dx, dz);
+}
+static inline vm passes(const SectorThresholds &t, int i, vm upper, vf dx, vf dz) {
+    vf rayX = vsel(upper, vload(&t.upperX[i]), vload(&t.lowerX[i]));
+    vf rayZ = vsel(upper, vload(&t.upperZ[i]), vload(&t.lowerZ[i]));
+    vf bias = vsel(upper, vload(&t.upperBias[i]), vload(&t.lowerBias[i]));
+    vf facing = vsel(upper, vadd(vmul(vload(&t.facingX[i]), dx), vmul(vload(&t.facingZ[i]), dz)), vset(0));
+    return mand(vge(vadd(vsub(vmul(rayX, dz), vmul(rayZ, dx)), bias), vset(0)), vge(facing, vset(0)));
+}
+bool anySectorHit(const SectorTable &table, int begin, int end, float x, float z) {
+    const vf px = vset(x), pz = vset(z), zero = vset(0);
+    const vf last = vset(end - 1);
+    for (int i = begin; i < end; i += SIMD_WIDTH) {
+        // Lanes past end read the next entries (or the table padding) and are masked off
+        vm valid = vle(vadd(vlanes(), vset(i)), last);
+        vf dx = vsub(px, vload(&table.cx[i]));
+        vf dz = vsub(pz, vload(&table.cz[i]));
+        vf distSquared = vadd(vmul(dx, dx), vmul(dz, dz));
+        vm upper = vge(dz, zero);
+
+        vm ring = mand(mand(vle(distSquared, vload(&table.outerSquared[i])), vge(distSquared, vload(&table.innerSquared[i]))), valid);
+        if (!many(ring)) continue; // Most queries are clear of every ring
+
+        vm afterStart = passes(table.start, i, upper, dx, dz);
+        vm beforeEnd = passes(table.end, i, upper, dx, dz);
+        vm wraps = mload(&table.wraps[i]);
+        vm angle = mor(mandnot(mand(afterStart, beforeEnd), wraps), mand(wraps, mor(afterStart, beforeEnd)));
+        if (many(mand(ring, angle))) return true;
+    }
+    return false;
+}
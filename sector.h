@@ -0,0 +1,56 @@
+/******************************************
+*
+* Collision kernel for curved (annular sector) barriers.
+* The angular test uses cross products against precomputed start/end
+* direction vectors instead of atan2/fmod, and the SIMD path tests
+* several barriers per instruction.
+*
+*******************************************/
+
+#ifndef SECTOR_H
+#define SECTOR_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// One angular threshold of isWithinAngles(), as a pair of boundary rays.
+// Points with dz >= 0 are compared against the upper ray, others against the
+// lower one: (rayX * dz - rayZ * dx) + bias >= 0 means "at or past the threshold".
+// A zero ray with bias +1/-1 encodes a threshold that is always/never passed.
+struct SectorThresholds {
+    std::vector<float> upperX, upperZ, upperBias;
+    std::vector<float> lowerX, lowerZ, lowerBias;
+    std::vector<float> facingX, facingZ;  // Upper half only: (facingX * dx + facingZ * dz) >= 0 is also required
+
+    size_t bytes() const {
+        return (upperX.size() + upperZ.size() + upperBias.size() + lowerX.size() + lowerZ.size() + lowerBias.size() +
+                facingX.size() + facingZ.size()) * sizeof(float);
+    }
+};
+
+// Curved barriers in structure-of-arrays form, expanded by the car radius
+struct SectorTable {
+    int count = 0;
+    std::vector<float> cx, cz;
+    std::vector<float> outerSquared, innerSquared;
+    SectorThresholds start, end;  // end thresholds are stored negated ("at or before")
+    std::vector<int32_t> wraps;   // -1 when the normalised start angle is past the end angle
+
+    size_t bytes() const {
+        return (cx.size() + cz.size() + outerSquared.size() + innerSquared.size()) * sizeof(float) +
+               start.bytes() + end.bytes() + wraps.size() * sizeof(int32_t);
+    }
+};
+
+// Precompute the table from rows of curveBarriers. With order set, entry i
+// is built from circles[order[i]] (used to lay out per-cell copies).
+void buildSectorTable(SectorTable &table, float circles[][7], int numCircles, const int *order = nullptr);
+
+// Same result as isInsideCircle() on entry i, without atan2/fmod
+bool sectorHit(const SectorTable &table, int i, float x, float z);
+
+// Check if (x, z) hits any entry in [begin, end), several entries per SIMD instruction
+bool anySectorHit(const SectorTable &table, int begin, int end, float x, float z);
+
+#endif
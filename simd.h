@@ -0,0 +1,121 @@
+/******************************************
+*
+* Thin wrappers over AVX2 / SSE2 intrinsics with a scalar fallback, so the
+* same kernel source builds for whatever the target supports. vf holds
+* SIMD_WIDTH floats, vm a per-lane mask.
+*
+*******************************************/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_WIDTH 8
+typedef __m256 vf;
+typedef __m256 vm;
+static inline vf vload(const float *p) { return _mm256_loadu_ps(p); }
+static inline void vstore(float *p, vf a) { _mm256_storeu_ps(p, a); }
+static inline vf vset(float a) { return _mm256_set1_ps(a); }
+static inline vf vlanes() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+static inline vf vadd(vf a, vf b) { return _mm256_add_ps(a, b); }
+static inline vf vsub(vf a, vf b) { return _mm256_sub_ps(a, b); }
+static inline vf vmul(vf a, vf b) { return _mm256_mul_ps(a, b); }
+static inline vf vdiv(vf a, vf b) { return _mm256_div_ps(a, b); }
+static inline vf vmin(vf a, vf b) { return _mm256_min_ps(a, b); }
+static inline vf vmax(vf a, vf b) { return _mm256_max_ps(a, b); }
+static inline vf vabs(vf a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+static inline vm vgt(vf a, vf b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline vm vlt(vf a, vf b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline vm vge(vf a, vf b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline vm vle(vf a, vf b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline vm vne(vf a, vf b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_OQ); }
+static inline vm mand(vm a, vm b) { return _mm256_and_ps(a, b); }
+static inline vm mor(vm a, vm b) { return _mm256_or_ps(a, b); }
+static inline vm mandnot(vm a, vm b) { return _mm256_andnot_ps(b, a); } // a && !b
+static inline vm mnone() { return _mm256_setzero_ps(); }
+static inline bool many(vm a) { return _mm256_movemask_ps(a) != 0; }
+static inline vf vsel(vm m, vf a, vf b) { return _mm256_blendv_ps(b, a, m); }
+static inline vm mload(const int32_t *p) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i zero = _mm256_cmpeq_epi32(v, _mm256_setzero_si256());
+    return _mm256_castsi256_ps(_mm256_xor_si256(zero, _mm256_set1_epi32(-1)));
+}
+static inline vm mbits(const int32_t *p, int32_t flag) {
+    __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)p), _mm256_set1_epi32(flag));
+    return _mm256_castsi256_ps(_mm256_cmpeq_epi32(v, _mm256_set1_epi32(flag)));
+}
+static inline void mstore(int32_t *p, vm a) { _mm256_storeu_si256((__m256i *)p, _mm256_castps_si256(a)); }
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_WIDTH 4
+typedef __m128 vf;
+typedef __m128 vm;
+static inline vf vload(const float *p) { return _mm_loadu_ps(p); }
+static inline void vstore(float *p, vf a) { _mm_storeu_ps(p, a); }
+static inline vf vset(float a) { return _mm_set1_ps(a); }
+static inline vf vlanes() { return _mm_setr_ps(0, 1, 2, 3); }
+static inline vf vadd(vf a, vf b) { return _mm_add_ps(a, b); }
+static inline vf vsub(vf a, vf b) { return _mm_sub_ps(a, b); }
+static inline vf vmul(vf a, vf b) { return _mm_mul_ps(a, b); }
+static inline vf vdiv(vf a, vf b) { return _mm_div_ps(a, b); }
+static inline vf vmin(vf a, vf b) { return _mm_min_ps(a, b); }
+static inline vf vmax(vf a, vf b) { return _mm_max_ps(a, b); }
+static inline vf vabs(vf a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline vm vgt(vf a, vf b) { return _mm_cmpgt_ps(a, b); }
+static inline vm vlt(vf a, vf b) { return _mm_cmplt_ps(a, b); }
+static inline vm vge(vf a, vf b) { return _mm_cmpge_ps(a, b); }
+static inline vm vle(vf a, vf b) { return _mm_cmple_ps(a, b); }
+static inline vm vne(vf a, vf b) { return _mm_cmpneq_ps(a, b); }
+static inline vm mand(vm a, vm b) { return _mm_and_ps(a, b); }
+static inline vm mor(vm a, vm b) { return _mm_or_ps(a, b); }
+static inline vm mandnot(vm a, vm b) { return _mm_andnot_ps(b, a); } // a && !b
+static inline vm mnone() { return _mm_setzero_ps(); }
+static inline bool many(vm a) { return _mm_movemask_ps(a) != 0; }
+static inline vf vsel(vm m, vf a, vf b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+static inline vm mload(const int32_t *p) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i zero = _mm_cmpeq_epi32(v, _mm_setzero_si128());
+    return _mm_castsi128_ps(_mm_xor_si128(zero, _mm_set1_epi32(-1)));
+}
+static inline vm mbits(const int32_t *p, int32_t flag) {
+    __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)p), _mm_set1_epi32(flag));
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(v, _mm_set1_epi32(flag)));
+}
+static inline void mstore(int32_t *p, vm a) { _mm_storeu_si128((__m128i *)p, _mm_castps_si128(a)); }
+#else
+#define SIMD_WIDTH 1
+typedef float vf;
+typedef bool vm;
+static inline vf vload(const float *p) { return *p; }
+static inline void vstore(float *p, vf a) { *p = a; }
+static inline vf vset(float a) { return a; }
+static inline vf vlanes() { return 0; }
+static inline vf vadd(vf a, vf b) { return a + b; }
+static inline vf vsub(vf a, vf b) { return a - b; }
+static inline vf vmul(vf a, vf b) { return a * b; }
+static inline vf vdiv(vf a, vf b) { return a / b; }
+static inline vf vmin(vf a, vf b) { return std::min(a, b); }
+static inline vf vmax(vf a, vf b) { return std::max(a, b); }
+static inline vf vabs(vf a) { return std::fabs(a); }
+static inline vm vgt(vf a, vf b) { return a > b; }
+static inline vm vlt(vf a, vf b) { return a < b; }
+static inline vm vge(vf a, vf b) { return a >= b; }
+static inline vm vle(vf a, vf b) { return a <= b; }
+static inline vm vne(vf a, vf b) { return a != b; }
+static inline vm mand(vm a, vm b) { return a && b; }
+static inline vm mor(vm a, vm b) { return a || b; }
+static inline vm mandnot(vm a, vm b) { return a && !b; }
+static inline vm mnone() { return false; }
+static inline bool many(vm a) { return a; }
+static inline vf vsel(vm m, vf a, vf b) { return m ? a : b; }
+static inline vm mload(const int32_t *p) { return *p != 0; }
+static inline vm mbits(const int32_t *p, int32_t flag) { return (*p & flag) == flag; }
+static inline void mstore(int32_t *p, vm a) { *p = a ? -1 : 0; }
+#endif
+
+#endif
@@ -0,0 +1,294 @@
+/******************************************
+*
+* Headless vehicle simulation. Extracted from the GLUT timer callback so
+* the same rules can run without a window or GL context.
+*
+*******************************************/
+
+#include <cmath>
+#include <algorithm>
+
+#include "simulation.h"
+#include "track.h"
+#include "barriergrid.h"
+#include "distancefield.h"
+#include "profile.h"
+
+static BarrierGrid trackGrid;  // Spatial index over the track barriers
+static bool trackGridBuilt = false;
+static DistanceField trackField;  // Signed distance to the track barriers
+static bool trackFieldBaked = false;
+
+void resetSimulation(SimState &state) {
+    SimParams params = state.params;
+    state = SimState();
+    state.params = params;
+    state.meX = trackStart[0];
+    state.meZ = trackStart[1];
+    state.angleX = trackStart[2];
+}
+
+// Check if a car at (x, z) overlaps one along-axis barrier box
+bool isInsideBox(float x, float z, const float box[6]) {
+    float radius = 5.0f; // Radius of the circle around the point
+
+    // Calculate expanded bounds to include the circle's radius
+    float x1 = fmin(box[0], box[3]) - radius;
+    float x2 = fmax(box[0], box[3]) + radius;
+    float z1 = fmin(box[2], box[5]) - radius;
+    float z2 = fmax(box[2], box[5]) + radius;
+
+    // Check if the center of the circle is within the expanded bounds
+    return x >= x1 && x <= x2 && z >= z1 && z <= z2;
+}
+int isInsideAnyBox(float x, float z, float boxes[][6], int numBoxes) {
+    for (int i = 0; i < numBoxes; i++) {
+        if (isInsideBox(x, z, boxes[i])) {
+            return 1; // Center of the circle is within an expanded box
+        }
+    }
+    return 0; // Center of the circle is not inside any expanded box
+}
+bool isWithinAngles(float x, float z, float cx, float cz, float startAngle, float endAngle) {
+    float angleToPoint = atan2(z - cz, x - cx) * 180.0 / PI;
+    if (angleToPoint < 0) angleToPoint += 360;
+
+    float normalizedStartAngle = fmod(startAngle, 360);
+    float normalizedEndAngle = fmod(endAngle, 360);
+
+    if (normalizedStartAngle <= normalizedEndAngle) {
+        return angleToPoint >= normalizedStartAngle && angleToPoint <= normalizedEndAngle;
+    } else {
+        return angleToPoint >= normalizedStartAngle || angleToPoint <= normalizedEndAngle;
+    }
+}
+// Check if a car at (x, z) intersects one annular or partial ring barrier
+bool isInsideCircle(float x, float z, const float circle[7]) {
+    float carRadius = 6;
+
+    // Circle center and radii
+    float cx = circle[0];
+    float cz = circle[2];
+    float outerRadius = circle[3] + carRadius;
+    float innerRadius = circle[4] - carRadius;
+    float startAngle = circle[5] * 180.0 / PI;
+    float endAngle = circle[6] * 180.0 / PI;
+    float outerRadiusSquared = outerRadius * outerRadius;
+    float innerRadiusSquared = innerRadius * innerRadius;
+
+    // Calculate squared distance from point to circle center
+    float dx = x - cx;
+    float dz = z - cz;
+    float distSquared = dx * dx + dz * dz;
+
+    // Check if within annular range
+    return distSquared <= outerRadiusSquared && distSquared >= innerRadiusSquared && isWithinAngles(x, z, cx, cz, startAngle, endAngle);
+}
+// Function to determine if a point (x, z) intersects with any annular or partial ring barrier.
+int isInsideAnyCircle(float x, float z, float circles[][7], int numCircles) {
+    for (int i = 0; i < numCircles; i++) {
+        if (isInsideCircle(x, z, circles[i])) {
+            return 1; // Collision detected
+        }
+    }
+    return 0; // No collision detected
+}
+void rebuildTrackCollision() {
+    buildBarrierGrid(trackGrid, axisBarriers, axisBarriersCount, curveBarriers, curveBarriersCount);
+    trackGridBuilt = true;
+    if (trackFieldBaked) bakeTrackDistanceField(trackField.cellSize);
+}
+void bakeTrackDistanceField(float cellSize) {
+    bakeDistanceField(trackField, axisBarriers, axisBarriersCount, curveBarriers, curveBarriersCount, cellSize);
+    trackFieldBaked = true;
+}
+const DistanceField &trackDistanceField() {
+    if (!trackFieldBaked) bakeTrackDistanceField();
+    return trackField;
+}
+bool moveWithDistanceField(float &x, float &z, float &velocity, float dirX, float dirZ, float distance, const SimParams &p) {
+    const DistanceField &field = trackDistanceField();
+    if (p.sweptCollision) { // Stop at the first contact along the way instead of jumping past thin walls
+        distance *= sweepDistanceField(field, x, z, x + distance * dirX, z + distance * dirZ, p.carRadius);
+    }
+    float proposedX = x + distance * dirX;
+    float proposedZ = z + distance * dirZ;
+    float normalX, normalZ;
+    float clearance = sampleDistanceField(field, proposedX, proposedZ, &normalX, &normalZ);
+    if (clearance >= p.carRadius) {
+        x = proposedX;
+        z = proposedZ;
+        return false;
+    }
+
+    // Push out of the barrier along the contact normal
+    float penetration = p.carRadius - clearance;
+    proposedX += normalX * penetration;
+    proposedZ += normalZ * penetration;
+
+    // Reflect the normal part of the motion, keep the tangential part
+    float moveX = velocity * dirX, moveZ = velocity * dirZ;
+    float normalSpeed = moveX * normalX + moveZ * normalZ;
+    if (normalSpeed < 0) {
+        moveX -= (1 + p.elasticity) * normalSpeed * normalX;
+        moveZ -= (1 + p.elasticity) * normalSpeed * normalZ;
+    }
+    velocity = moveX * dirX + moveZ * dirZ; // The car can only move along its heading
+
+    // Stay put if pushing out lands in another barrier (e.g. in a tight corner)
+    if (sampleDistanceField(field, proposedX, proposedZ) >= p.carRadius - 0.5f * penetration) {
+        x = proposedX;
+        z = proposedZ;
+    }
+    return true;
+}
+bool collidesWithTrack(float x, float z) {
+    if (!trackGridBuilt) rebuildTrackCollision();
+    return gridCollides(trackGrid, x, z);
+}
+bool sweepTrack(float x0, float z0, float x1, float z1, float *hitT) {
+    if (!trackGridBuilt) rebuildTrackCollision();
+    return gridSweep(trackGrid, x0, z0, x1, z1, hitT);
+}
+// Part of a move of distance units that ends just short of a contact at hitT
+static float shortOfContact(float distance, float hitT) {
+    const float contactGap = 0.001f;
+    float travelled = std::fabs(distance) * hitT - contactGap;
+    if (travelled <= 0) return 0;
+    return distance > 0 ? travelled : -travelled;
+}
+bool moveSwept(float &x, float &z, float &velocity, float dirX, float dirZ, float distance, const SimParams &p) {
+    float hitT;
+    bool hit = sweepTrack(x, z, x + distance * dirX, z + distance * dirZ, &hitT);
+    if (hit) {
+        // Advance to the first contact, then bounce back as the end position
+        // test does, without passing through anything behind the car either
+        float travelled = shortOfContact(distance, hitT);
+        x += travelled * dirX;
+        z += travelled * dirZ;
+        velocity = -velocity * p.elasticity;
+        distance = -distance * p.elasticity;
+        if (sweepTrack(x, z, x + distance * dirX, z + distance * dirZ, &hitT)) distance = shortOfContact(distance, hitT);
+    }
+    x += distance * dirX;
+    z += distance * dirZ;
+    return hit;
+}
+bool isCheckpointReached(int checkpoint, float x, float z) {
+    if (checkpoint >= checkpointsCount) return false;
+    const float *box = checkpoints[checkpoint];
+    return x > box[0] && z > box[1] && x < box[2] && z < box[3];
+}
+int updateCheckpoint(SimState &state, float x, float z) {
+    if (state.currentCheckpoint == 0 && state.timerRunning) return 0;
+    if (!isCheckpointReached(state.currentCheckpoint, x, z)) return 0;
+
+    state.currentCheckpoint++;
+    if (state.currentCheckpoint == 1) {
+        state.lapStartTime = state.time;
+        state.lapStarted = true;
+        state.timerRunning = true;
+        return SIM_EVENT_LAP_STARTED;
+    }
+    if (state.currentCheckpoint == checkpointsCount) {
+        state.timerRunning = false;
+        state.lapEndTime = state.time;
+        return SIM_EVENT_LAP_COMPLETED;
+    }
+    return 0;
+}
+// Throttle, brake and steering for one step
+static void stepControls(SimState &state, const SimInputs &inputs, float ticks) {
+    PROFILE_SCOPE("sim controls");
+    const SimParams &p = state.params;
+    if (inputs.accelerate) { // Accelerate
+        state.velocity += p.acceleration * ticks;
+        if (state.velocity > p.maxVelocity) state.velocity = p.maxVelocity;
+    } else if (inputs.brake && state.lapStarted) { // Decelerate
+        state.velocity -= p.deceleration * ticks;
+        if (state.velocity < -p.maxVelocity) state.velocity = -p.maxVelocity;
+    } else { // Automatic deceleration when no keys are pressed
+        if (state.velocity > 0) state.velocity -= p.deceleration * ticks;
+        else if (state.velocity < 0) state.velocity += p.deceleration * ticks;
+        if (std::abs(state.velocity) < p.deceleration * ticks) state.velocity = 0; // Stop completely if speed is very low
+    }
+
+    // Handling turning while moving
+    if (state.velocity != 0 && state.lapStarted) {
+        float turnAdjustment = (std::fabs(state.velocity) <= 2) ?
+            (p.turnSpeed * 0.5f * (state.velocity > 0 ? 1 : -1)) :
+            (p.turnSpeed * (1.0f - 0.5f * (std::fabs(state.velocity) / p.maxVelocity)) * (state.velocity > 0 ? 1 : -1));
+
+        if (inputs.steerLeft) { // Turn left
+            state.angleX += turnAdjustment * ticks;
+            state.wheelAngle += state.wheelAngle < p.maxWheelAngle ? p.wheelAngleStep * ticks : 0;
+            state.wheelAngle = std::min(state.wheelAngle, p.maxWheelAngle); // Ensure it does not exceed max angle
+        } else if (inputs.steerRight) { // Turn right
+            state.angleX -= turnAdjustment * ticks;
+            state.wheelAngle -= state.wheelAngle > -p.maxWheelAngle ? p.wheelAngleStep * ticks : 0;
+            state.wheelAngle = std::max(state.wheelAngle, -p.maxWheelAngle); // Ensure it does not exceed min angle
+        }
+    } else {
+        // If the car is not moving, gradually return the wheel to the center
+        if (state.wheelAngle < 0) {
+            state.wheelAngle += p.wheelAngleStep * ticks;
+            state.wheelAngle = std::min(state.wheelAngle, 0.0f); // Do not overshoot the center
+        } else if (state.wheelAngle > 0) {
+            state.wheelAngle -= p.wheelAngleStep * ticks;
+            state.wheelAngle = std::max(state.wheelAngle, 0.0f); // Do not overshoot the center
+        }
+    }
+}
+// Move along the heading and resolve barrier contact. Returns true on contact.
+static bool moveCar(SimState &state, float ticks) {
+    PROFILE_SCOPE("sim collision");
+    const SimParams &p = state.params;
+    // Check if the proposed new position is within any barriers and then update position
+    float dirX = sin(state.angleX * PI / 180);
+    float dirZ = cos(state.angleX * PI / 180);
+    float distance = state.velocity * ticks;
+    if (p.distanceFieldCollision) {
+        return moveWithDistanceField(state.meX, state.meZ, state.velocity, dirX, dirZ, distance, p);
+    }
+    if (p.sweptCollision) {
+        return moveSwept(state.meX, state.meZ, state.velocity, dirX, dirZ, distance, p);
+    }
+    float proposedMeZ = state.meZ + distance * dirZ;
+    float proposedMeX = state.meX + distance * dirX;
+    if (!collidesWithTrack(proposedMeX, proposedMeZ)) {
+        // If not inside any barrier, update the position
+        state.meZ = proposedMeZ;
+        state.meX = proposedMeX;
+        return false;
+    } else {
+        // Collision detected, apply bounce back
+        state.velocity = -state.velocity * p.elasticity; // Reverse and reduce velocity
+
+        // Recalculate position using adjusted velocity
+        distance = state.velocity * ticks;
+        state.meZ += distance * dirZ;
+        state.meX += distance * dirX;
+        return true;
+    }
+}
+int stepSimulation(SimState &state, const SimInputs &inputs, float dt) {
+    float ticks = dt / SIM_TICK_SECONDS; // Tuning constants are per reference tick
+    state.time += dt;
+
+    stepControls(state, inputs, ticks);
+    int events = moveCar(state, ticks) ? SIM_EVENT_COLLISION : 0;
+
+    PROFILE_SCOPE("sim checkpoints");
+    return events | updateCheckpoint(state, state.meX, state.meZ);
+}
+SimState interpolateSimulation(const SimState &a, const SimState &b, float t) {
+    SimState state = b;
+    state.meX = a.meX + (b.meX - a.meX) * t;
+    state.meY = a.meY + (b.meY - a.meY) * t;
+    state.meZ = a.meZ + (b.meZ - a.meZ) * t;
+    state.angleX = a.angleX + (b.angleX - a.angleX) * t; // Headings are not wrapped, so this takes the short way
+    state.velocity = a.velocity + (b.velocity - a.velocity) * t;
+    state.wheelAngle = a.wheelAngle + (b.wheelAngle - a.wheelAngle) * t;
+    state.time = a.time + (b.time - a.time) * t;
+    return state;
+}
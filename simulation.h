@@ -0,0 +1,109 @@
+/******************************************
+*
+* Headless vehicle simulation: car physics, barrier collision and
+* checkpoint/lap logic. No GL/GLUT dependencies, so it can be stepped
+* as fast as the CPU allows.
+*
+*******************************************/
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#define SIM_TICK_SECONDS 0.016f  // Reference tick the per-tick tuning constants below are expressed in
+
+// Events reported by stepSimulation()
+#define SIM_EVENT_LAP_STARTED   1
+#define SIM_EVENT_LAP_COMPLETED 2
+#define SIM_EVENT_COLLISION     4  // The car touched a barrier
+
+// Per-tick driver inputs packed as bit flags (used by the batch simulator)
+#define SIM_INPUT_ACCELERATE  1
+#define SIM_INPUT_BRAKE       2
+#define SIM_INPUT_STEER_LEFT  4
+#define SIM_INPUT_STEER_RIGHT 8
+
+// Per-tick driver inputs (the w/s/a/d key states)
+struct SimInputs {
+    bool accelerate = false;
+    bool brake = false;
+    bool steerLeft = false;
+    bool steerRight = false;
+};
+
+// Vehicle tuning, in units per reference tick
+struct SimParams {
+    float acceleration = 0.05f;
+    float deceleration = 0.02f;
+    float maxVelocity = 3.0f;
+    float turnSpeed = 3.0f;
+    float maxWheelAngle = 25.0f;
+    float wheelAngleStep = 5.0f;
+    float elasticity = 0.25f; // Coefficient of how much velocity is preserved after a bounce
+    bool distanceFieldCollision = false; // Collide against the baked distance field and slide along walls
+    float carRadius = 5.0f;              // Car footprint used by the distance field collision
+    bool sweptCollision = false;         // Test the whole path of each move, not just its end, so long moves cannot tunnel
+};
+
+// Complete simulation state of one car
+struct SimState {
+    float meX = 240, meY = 0, meZ = -40;
+    float angleX = 0;
+    float velocity = 0;
+    float wheelAngle = 0;
+    int currentCheckpoint = 0;
+    bool timerRunning = false;
+    bool lapStarted = false;  // Steering and reversing are locked until the lap has started
+    double time = 0;          // Simulated seconds since start
+    double lapStartTime = 0, lapEndTime = 0;
+    SimParams params;
+};
+
+// Reposition the car at the track's start and clear lap timing (params are kept)
+void resetSimulation(SimState &state);
+
+// Advance the simulation by dt seconds. A dt of SIM_TICK_SECONDS reproduces one
+// tick of the original 16 ms timer loop exactly. Returns a mask of SIM_EVENT_* flags.
+int stepSimulation(SimState &state, const SimInputs &inputs, float dt = SIM_TICK_SECONDS);
+
+// The state a fraction t of the way from a to b (consecutive ticks), for drawing
+// between ticks. The pose and time are blended; everything else is b's.
+SimState interpolateSimulation(const SimState &a, const SimState &b, float t);
+
+// Collision queries against the track barriers (see track.h)
+bool isInsideBox(float x, float z, const float box[6]);
+int isInsideAnyBox(float x, float z, float boxes[][6], int numBoxes);
+bool isWithinAngles(float x, float z, float cx, float cz, float startAngle, float endAngle);
+bool isInsideCircle(float x, float z, const float circle[7]);
+int isInsideAnyCircle(float x, float z, float circles[][7], int numCircles);
+
+// Indexed query against the track barriers. The index is built on first use;
+// call rebuildTrackCollision() after changing the barrier arrays.
+bool collidesWithTrack(float x, float z);
+void rebuildTrackCollision();
+
+// Swept query along the move from (x0, z0) to (x1, z1). Returns true if the car
+// touches a barrier on the way, with the fraction of the move travelled in *hitT.
+bool sweepTrack(float x0, float z0, float x1, float z1, float *hitT);
+
+// Move a car distance units along its heading, stopping at the first barrier
+// on the way and bouncing back from there with the elasticity. Returns true on contact.
+bool moveSwept(float &x, float &z, float &velocity, float dirX, float dirZ, float distance, const SimParams &p);
+
+// Signed-distance field of the track barriers, baked on first use with
+// samples cellSize units apart. bakeTrackDistanceField() re-bakes it.
+struct DistanceField;
+void bakeTrackDistanceField(float cellSize = 1.0f);
+const DistanceField &trackDistanceField();
+
+// Move a car distance units along its heading against the distance field.
+// On contact the car is pushed out along the contact normal and the normal
+// part of its velocity is reflected with the elasticity, so glancing hits slide.
+// Returns true on contact.
+bool moveWithDistanceField(float &x, float &z, float &velocity, float dirX, float dirZ, float distance, const SimParams &p);
+
+// Advance the lap checkpoint state machine for the car's position through the
+// track's checkpoints. The first starts the lap timer, the last completes the lap.
+bool isCheckpointReached(int checkpoint, float x, float z);
+int updateCheckpoint(SimState &state, float x, float z);
+
+#endif
@@ -0,0 +1,307 @@
+/******************************************
+*
+* Batched text.
+*
+*******************************************/
+
+#include <cmath>
+#include <algorithm>
+
+#ifdef __APPLE__
+#  include <GLUT/glut.h>
+#else
+#  include <GL/glut.h>
+#endif
+
+#include "text.h"
+#include "mesh.h"
+
+#define TEXT_PADDING 2       // Empty texels around each glyph, so neighbours never bleed in
+#define TEXT_STROKE_SCALE 0.3f  // Atlas texels per stroke-font unit
+
+// Cell height and the part of it below the baseline. GLUT does not report these
+// portably, so they are the freeglut values; anything else gets a generous cell.
+struct FontMetrics {
+    void *glutFont;
+    float height, descent;
+};
+static const FontMetrics fontMetrics[] = {
+    {GLUT_BITMAP_8_BY_13, 14, 3},
+    {GLUT_BITMAP_9_BY_15, 16, 4},
+    {GLUT_BITMAP_HELVETICA_10, 14, 3},
+    {GLUT_BITMAP_HELVETICA_12, 16, 4},
+    {GLUT_BITMAP_HELVETICA_18, 23, 5},
+    {GLUT_BITMAP_TIMES_ROMAN_10, 14, 4},
+    {GLUT_BITMAP_TIMES_ROMAN_24, 29, 7},
+    {GLUT_STROKE_ROMAN, 152.38f, 33.33f},
+    {GLUT_STROKE_MONO_ROMAN, 152.38f, 33.33f},
+};
+static FontMetrics metricsOf(void *glutFont) {
+    for (const FontMetrics &metrics : fontMetrics) {
+        if (metrics.glutFont == glutFont) return metrics;
+    }
+    FontMetrics fallback = {glutFont, 32, 8};
+    return fallback;
+}
+static bool isStrokeFont(void *glutFont) {
+    return glutFont == GLUT_STROKE_ROMAN || glutFont == GLUT_STROKE_MONO_ROMAN;
+}
+
+void buildTextAtlas(TextAtlas &atlas, std::initializer_list<void *> glutFonts) {
+    if (atlas.texture) return;
+
+    // No wider than the window, so whole shelves of glyphs can be drawn and read back at once
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    atlas.width = 64;
+    while (atlas.width * 2 <= std::min(512, (int)viewport[2])) atlas.width *= 2;
+
+    // Pack the glyphs into shelves, left to right
+    std::vector<int> shelves;  // Top of each shelf
+    int penX = 0, penY = 0, shelfHeight = 0;
+    atlas.fonts.clear();
+    for (void *glutFont : glutFonts) {
+        FontMetrics metrics = metricsOf(glutFont);
+        TextFont font;
+        font.glutFont = glutFont;
+        font.stroke = isStrokeFont(glutFont);
+        font.scale = font.stroke ? TEXT_STROKE_SCALE : 1;
+        font.originX = TEXT_PADDING;
+        font.originY = TEXT_PADDING + ceil(metrics.descent * font.scale);
+        int cellHeight = (int)ceil(metrics.height * font.scale) + 2 * TEXT_PADDING;
+
+        for (int c = 0; c < TEXT_CHARS; ++c) {
+            TextGlyph &glyph = font.glyphs[c];
+            glyph.advance = font.stroke ? glutStrokeWidth(glutFont, TEXT_FIRST_CHAR + c)
+                                        : glutBitmapWidth(glutFont, TEXT_FIRST_CHAR + c);
+            glyph.width = (int)ceil(glyph.advance * font.scale) + 2 * TEXT_PADDING;
+            glyph.height = cellHeight;
+            if (penX + glyph.width > atlas.width) {
+                shelves.push_back(penY);
+                penX = 0;
+                penY += shelfHeight;
+                shelfHeight = 0;
+            }
+            glyph.x = penX;
+            glyph.y = penY;
+            penX += glyph.width;
+            shelfHeight = std::max(shelfHeight, cellHeight);
+        }
+        atlas.fonts.push_back(font);
+    }
+    shelves.push_back(penY);
+    shelves.push_back(penY + shelfHeight);
+    atlas.height = 64;
+    while (atlas.height < shelves.back()) atlas.height *= 2;
+
+    // Draw the glyphs white on black into the back buffer, a band of shelves at a time
+    std::vector<unsigned char> alpha((size_t)atlas.width * atlas.height, 0);
+    glPushAttrib(GL_ENABLE_BIT | GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_LINE_BIT);
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_BLEND);
+    glDisable(GL_ALPHA_TEST);
+    glDisable(GL_FOG);
+    glLineWidth(1);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glClearColor(0, 0, 0, 1);
+
+    size_t shelf = 0;
+    while (shelf + 1 < shelves.size()) {
+        int top = shelves[shelf], bottom = shelves[++shelf];
+        while (shelf + 1 < shelves.size() && shelves[shelf + 1] - top <= viewport[3]) bottom = shelves[++shelf];
+
+        glViewport(0, 0, atlas.width, bottom - top);
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        gluOrtho2D(0, atlas.width, top, bottom);
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        glClear(GL_COLOR_BUFFER_BIT);
+        glColor3f(1, 1, 1);
+
+        for (const TextFont &font : atlas.fonts) {
+            for (int c = 0; c < TEXT_CHARS; ++c) {
+                const TextGlyph &glyph = font.glyphs[c];
+                if (glyph.y < top || glyph.y >= bottom) continue;
+                if (font.stroke) {
+                    glPushMatrix();
+                    glTranslatef(glyph.x + font.originX, glyph.y + font.originY, 0);
+                    glScalef(font.scale, font.scale, 1);
+                    glutStrokeCharacter(font.glutFont, TEXT_FIRST_CHAR + c);
+                    glPopMatrix();
+                } else {
+                    glRasterPos2f(glyph.x + font.originX, glyph.y + font.originY);
+                    glutBitmapCharacter(font.glutFont, TEXT_FIRST_CHAR + c);
+                }
+            }
+        }
+        glReadPixels(0, 0, atlas.width, bottom - top, GL_RED, GL_UNSIGNED_BYTE, &alpha[(size_t)top * atlas.width]);
+    }
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopClientAttrib();
+    glPopAttrib();
+
+    glGenTextures(1, &atlas.texture);
+    glBindTexture(GL_TEXTURE_2D, atlas.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gluBuild2DMipmaps(GL_TEXTURE_2D, GL_ALPHA, atlas.width, atlas.height, GL_ALPHA, GL_UNSIGNED_BYTE, alpha.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static int fontIndex(const TextAtlas &atlas, void *glutFont) {
+    for (size_t f = 0; f < atlas.fonts.size(); ++f) {
+        if (atlas.fonts[f].glutFont == glutFont) return (int)f;
+    }
+    return -1;
+}
+
+// Quads for a string with the pen starting at the origin, in font units: x, y, u, v per
+// vertex. Built once per string; the cache is emptied when it fills up with changing text.
+static const std::vector<float> &layoutText(TextAtlas &atlas, int f, const char *string) {
+    std::string key(1, (char)f);
+    key += string;
+    auto cached = atlas.layouts.find(key);
+    if (cached != atlas.layouts.end()) return cached->second;
+    if (atlas.layouts.size() >= TEXT_CACHE_SIZE) atlas.layouts.clear();
+
+    const TextFont &font = atlas.fonts[f];
+    std::vector<float> &quads = atlas.layouts[key];
+    float pen = 0;
+    for (const char *c = string; *c; ++c) {
+        int index = (unsigned char)*c - TEXT_FIRST_CHAR;
+        if (index < 0 || index >= TEXT_CHARS) continue;
+        const TextGlyph &glyph = font.glyphs[index];
+
+        float x0 = pen - font.originX / font.scale, y0 = -font.originY / font.scale;
+        float x1 = x0 + glyph.width / font.scale, y1 = y0 + glyph.height / font.scale;
+        float u0 = (float)glyph.x / atlas.width, v0 = (float)glyph.y / atlas.height;
+        float u1 = (float)(glyph.x + glyph.width) / atlas.width, v1 = (float)(glyph.y + glyph.height) / atlas.height;
+        float corners[16] = {x0, y0, u0, v0, x1, y0, u1, v0, x1, y1, u1, v1, x0, y1, u0, v1};
+        quads.insert(quads.end(), corners, corners + 16);
+        pen += glyph.advance;
+    }
+    return quads;
+}
+
+void queueText(TextAtlas &atlas, void *glutFont, const char *string, float x, float y, const float color[3]) {
+    int f = fontIndex(atlas, glutFont);
+    if (f < 0) return;
+
+    // Window position of the pen, as glRasterPos2f() computes it
+    GLdouble modelview[16], projection[16], windowX, windowY, windowZ;
+    GLint viewport[4];
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
+    glGetDoublev(GL_PROJECTION_MATRIX, projection);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (!gluProject(x, y, 0, modelview, projection, viewport, &windowX, &windowY, &windowZ)) return;
+    float penX = floor(windowX + 0.001), penY = floor(windowY + 0.001); // Whole pixels, like glBitmap()
+
+    const std::vector<float> &quads = layoutText(atlas, f, string);
+    for (size_t i = 0; i < quads.size(); i += 4) {
+        float vertex[7] = {quads[i] + penX, quads[i + 1] + penY, quads[i + 2], quads[i + 3], color[0], color[1], color[2]};
+        atlas.queued.insert(atlas.queued.end(), vertex, vertex + 7);
+    }
+}
+
+void drawQueuedText(TextAtlas &atlas) {
+    if (atlas.queued.empty()) return;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT);
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(viewport[0], viewport[0] + viewport[2], viewport[1], viewport[1] + viewport[3]);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, atlas.texture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    const GLsizei stride = 7 * sizeof(float);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(2, GL_FLOAT, stride, &atlas.queued[0]);
+    glTexCoordPointer(2, GL_FLOAT, stride, &atlas.queued[2]);
+    glColorPointer(3, GL_FLOAT, stride, &atlas.queued[4]);
+    glDrawArrays(GL_QUADS, 0, (GLsizei)(atlas.queued.size() / 7));
+    countDraw(atlas.queued.size() / 7);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopClientAttrib();
+    glPopAttrib();
+    atlas.queued.clear();
+}
+
+float textWidth(TextAtlas &atlas, void *glutFont, const char *string) {
+    int f = fontIndex(atlas, glutFont);
+    if (f < 0) return 0;
+    float width = 0;
+    for (const char *c = string; *c; ++c) {
+        int index = (unsigned char)*c - TEXT_FIRST_CHAR;
+        if (index >= 0 && index < TEXT_CHARS) width += atlas.fonts[f].glyphs[index].advance;
+    }
+    return width;
+}
+
+void drawStrokeText(TextAtlas &atlas, void *glutFont, const char *string) {
+    int f = fontIndex(atlas, glutFont);
+    if (f < 0) return;
+    const std::vector<float> &quads = layoutText(atlas, f, string);
+    if (quads.empty()) return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT);
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, atlas.texture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    const GLsizei stride = 4 * sizeof(float);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, stride, &quads[0]);
+    glTexCoordPointer(2, GL_FLOAT, stride, &quads[2]);
+    glDrawArrays(GL_QUADS, 0, (GLsizei)(quads.size() / 4));
+    countDraw(quads.size() / 4);
+
+    glPopClientAttrib();
+    glPopAttrib();
+}
+
+void releaseTextAtlas(TextAtlas &atlas) {
+    if (atlas.texture) glDeleteTextures(1, &atlas.texture);
+    atlas.texture = 0;
+    atlas.layouts.clear();
+    atlas.queued.clear();
+}
@@ -0,0 +1,66 @@
+/******************************************
+*
+* Batched text. The GLUT fonts a window uses are rasterized once into a
+* single alpha atlas texture; strings are laid out as textured quads (and
+* the layout of each string is cached), queued during the frame and drawn
+* together with one draw call instead of one GLUT call per character.
+*
+*******************************************/
+
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <initializer_list>
+
+#define TEXT_FIRST_CHAR 32  // Printable ASCII only
+#define TEXT_CHARS 95
+#define TEXT_CACHE_SIZE 256  // Cached string layouts per atlas before the cache is flushed
+
+// Where one character sits in the atlas, in texels, and how far it advances the pen
+struct TextGlyph {
+    int x = 0, y = 0, width = 0, height = 0;
+    float advance = 0;
+};
+
+// One GLUT font in the atlas. Bitmap fonts are in pixels, stroke fonts in their own units.
+struct TextFont {
+    void *glutFont = nullptr;
+    bool stroke = false;
+    float scale = 1;         // Atlas texels per font unit
+    float originX = 0, originY = 0;  // Pen position inside each glyph cell, in texels
+    TextGlyph glyphs[TEXT_CHARS];
+};
+
+// Atlas texture plus the frame's queued quads. Each window has its own context, so its own atlas.
+struct TextAtlas {
+    std::vector<TextFont> fonts;
+    unsigned int texture = 0;
+    int width = 0, height = 0;
+
+    std::unordered_map<std::string, std::vector<float>> layouts;  // Font index + string -> quads
+    std::vector<float> queued;  // x, y, u, v, r, g, b per vertex, in window pixels
+};
+
+// Rasterize the fonts into the atlas if it has not been built yet. This draws into the
+// back buffer, so call it at the start of a frame, before the clear, with the window current.
+void buildTextAtlas(TextAtlas &atlas, std::initializer_list<void *> glutFonts);
+
+// Queue a bitmap-font string at (x, y), taken like glRasterPos2f through the current matrices
+void queueText(TextAtlas &atlas, void *glutFont, const char *string, float x, float y, const float color[3]);
+
+// Draw everything queued this frame in one call, on top of the scene, and empty the queue
+void drawQueuedText(TextAtlas &atlas);
+
+// Width of a string in pixels (bitmap fonts) or font units (stroke fonts), as glutBitmapLength()
+float textWidth(TextAtlas &atlas, void *glutFont, const char *string);
+
+// Draw a stroke-font string in the current modelview with the current colour, as a series
+// of glutStrokeCharacter() calls would, but as one draw call of textured quads
+void drawStrokeText(TextAtlas &atlas, void *glutFont, const char *string);
+
+void releaseTextAtlas(TextAtlas &atlas);
+
+#endif
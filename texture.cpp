@@ -0,0 +1,72 @@
+/******************************************
+*
+* Texture cache.
+*
+*******************************************/
+
+#include <iostream>
+#include <map>
+
+#ifdef __APPLE__
+#  include <GLUT/glut.h>
+#else
+#  include <GL/glut.h>
+#endif
+
+#include "texture.h"
+
+struct CachedTexture {
+    GLuint name = 0;
+    size_t bytes = 0;
+};
+static std::map<std::string, CachedTexture> textures;
+static size_t residentBytes = 0;
+
+unsigned int loadTexture(const std::string &path, bool repeat) {
+    auto found = textures.find(path);
+    if (found != textures.end()) return found->second.name;
+    Image image;
+    if (!loadBmp(image, path.c_str())) return 0;
+    buildMipChain(image);
+    return cacheTexture(path, image, repeat);
+}
+
+unsigned int cacheTexture(const std::string &key, const Image &image, bool repeat) {
+    CachedTexture &texture = textures[key];
+    if (!texture.name) glGenTextures(1, &texture.name);
+    residentBytes -= texture.bytes;
+    texture.bytes = image.bytes();
+    residentBytes += texture.bytes;
+
+    GLenum format = image.channels == 1 ? GL_ALPHA : image.channels == 3 ? GL_RGB : GL_RGBA;
+    GLenum wrap = repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+    glBindTexture(GL_TEXTURE_2D, texture.name);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Rows are tightly packed
+    for (size_t i = 0; i < image.levels.size(); i++) {
+        const ImageLevel &level = image.levels[i];
+        glTexImage2D(GL_TEXTURE_2D, i, format, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, image.level(i));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) std::cerr << "Texture " << key << ": OpenGL error " << gluErrorString(err) << std::endl;
+    return texture.name;
+}
+
+void releaseTextures() {
+    for (auto &entry : textures) glDeleteTextures(1, &entry.second.name);
+    textures.clear();
+    residentBytes = 0;
+}
+
+int textureCount() {
+    return (int)textures.size();
+}
+size_t textureResidentBytes() {
+    return residentBytes;
+}
@@ -0,0 +1,34 @@
+/******************************************
+*
+* Texture cache. Each texture is uploaded once with its full mip chain
+* and kept under a key (the file path for loaded images), so asking for
+* the same file again costs a map lookup. The bytes uploaded for every
+* level are counted, to budget resident texture memory.
+*
+*******************************************/
+
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <string>
+#include <cstddef>
+
+#include "image.h"
+
+// Texture for an image file, loaded and uploaded with mipmaps on first use.
+// Returns 0 (no texture) if the file cannot be decoded.
+unsigned int loadTexture(const std::string &path, bool repeat = true);
+
+// Upload an image (with its levels, if built) under key, replacing any texture
+// already there but keeping its name. Needs a current context.
+unsigned int cacheTexture(const std::string &key, const Image &image, bool repeat = true);
+
+// Delete every cached texture
+void releaseTextures();
+
+// Cached textures and the bytes uploaded for all their levels. Drivers may
+// pad RGB texels to four bytes, so actual use can be up to a third higher.
+int textureCount();
+size_t textureResidentBytes();
+
+#endif
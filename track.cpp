@@ -0,0 +1,267 @@
+/******************************************
+*
+* Track geometry shared by the simulation and the renderer.
+*
+*******************************************/
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "track.h"
+
+#define TRACK_MAGIC "RTRK"
+#define TRACK_VERSION 1
+
+int axisBarriersCount = 0;
+float (*axisBarriers)[6] = nullptr;
+int curveBarriersCount = 0;
+float (*curveBarriers)[7] = nullptr;
+int trackQuadsCount = 0;
+float (*trackQuads)[5][3] = nullptr;
+int trackCurvesCount = 0;
+float (*trackCurves)[7] = nullptr;
+int trackTreesCount = 0;
+float (*trackTrees)[5] = nullptr;
+int checkpointsCount = 0;
+float (*checkpoints)[4] = nullptr;
+float trackStart[3] = {240, -40, 0};
+
+// The arrays in file order, with their text keyword and floats per item
+struct TrackSectionFormat {
+    const char *keyword;
+    int floats;
+};
+static const TrackSectionFormat sections[TRACK_SECTIONS] = {
+    {"barrier", 6}, {"arc-barrier", 7}, {"floor", 15}, {"arc-floor", 7}, {"tree", 5}, {"checkpoint", 4},
+};
+
+// Binary form: this header, then each section's floats at its offset
+struct TrackFileHeader {
+    char magic[4];
+    uint32_t version;
+    float start[3];
+    uint32_t reserved;
+    uint32_t counts[TRACK_SECTIONS];
+    uint64_t offsets[TRACK_SECTIONS];  // Bytes from the start of the file
+};
+
+// Storage behind the arrays: a file mapping, or floats parsed from text or built in memory
+static void *mapping = nullptr;
+static size_t mappedBytes = 0;
+static std::vector<float> owned[TRACK_SECTIONS];
+
+static void setTrackArrays(const float start[3], float *data[TRACK_SECTIONS], const uint32_t counts[TRACK_SECTIONS]) {
+    memcpy(trackStart, start, sizeof(trackStart));
+    axisBarriers = (float (*)[6])data[0];
+    curveBarriers = (float (*)[7])data[1];
+    trackQuads = (float (*)[5][3])data[2];
+    trackCurves = (float (*)[7])data[3];
+    trackTrees = (float (*)[5])data[4];
+    checkpoints = (float (*)[4])data[5];
+    axisBarriersCount = counts[0];
+    curveBarriersCount = counts[1];
+    trackQuadsCount = counts[2];
+    trackCurvesCount = counts[3];
+    trackTreesCount = counts[4];
+    checkpointsCount = counts[5];
+}
+static void getTrackArrays(const float *data[TRACK_SECTIONS], uint32_t counts[TRACK_SECTIONS]) {
+    data[0] = (const float *)axisBarriers;
+    data[1] = (const float *)curveBarriers;
+    data[2] = (const float *)trackQuads;
+    data[3] = (const float *)trackCurves;
+    data[4] = (const float *)trackTrees;
+    data[5] = (const float *)checkpoints;
+    counts[0] = axisBarriersCount;
+    counts[1] = curveBarriersCount;
+    counts[2] = trackQuadsCount;
+    counts[3] = trackCurvesCount;
+    counts[4] = trackTreesCount;
+    counts[5] = checkpointsCount;
+}
+static void releaseTrack() {
+    if (mapping) munmap(mapping, mappedBytes);
+    mapping = nullptr;
+    mappedBytes = 0;
+    for (std::vector<float> &floats : owned) std::vector<float>().swap(floats);
+}
+static bool trackError(const char *path, const char *why) {
+    std::cerr << "Track " << path << ": " << why << std::endl;
+    return false;
+}
+
+bool setTrack(TrackBuilder &track) {
+    for (int s = 0; s < TRACK_SECTIONS; ++s) {
+        if (track.items[s].size() % sections[s].floats) return trackError(sections[s].keyword, "partial item in built track");
+    }
+    if (track.items[TRACK_CHECKPOINTS].size() < 2 * 4) return trackError("built", "needs at least two checkpoints");
+    releaseTrack();
+    float *arrays[TRACK_SECTIONS];
+    uint32_t counts[TRACK_SECTIONS];
+    for (int s = 0; s < TRACK_SECTIONS; ++s) {
+        owned[s].swap(track.items[s]);
+        arrays[s] = owned[s].data();
+        counts[s] = owned[s].size() / sections[s].floats;
+    }
+    setTrackArrays(track.start, arrays, counts);
+    return true;
+}
+
+/*\ ---- Binary form ---- \*/
+// Mapped copy-on-write, so the arrays stay writable without touching the file
+static bool mapTrack(const char *path, int file) {
+    struct stat info;
+    if (fstat(file, &info) != 0 || (size_t)info.st_size < sizeof(TrackFileHeader)) return trackError(path, "truncated header");
+    size_t bytes = info.st_size;
+    void *data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    if (data == MAP_FAILED) return trackError(path, "mmap failed");
+
+    const TrackFileHeader *header = (const TrackFileHeader *)data;
+    const char *why = nullptr;
+    if (header->version != TRACK_VERSION) why = "unsupported version";
+    float *arrays[TRACK_SECTIONS];
+    for (int s = 0; s < TRACK_SECTIONS && !why; ++s) {
+        uint64_t offset = header->offsets[s], size = (uint64_t)header->counts[s] * sections[s].floats * sizeof(float);
+        if (offset % alignof(float) != 0 || offset > bytes || size > bytes - offset) why = "section outside the file";
+        arrays[s] = (float *)((char *)data + offset);
+    }
+    if (!why && header->counts[TRACK_CHECKPOINTS] < 2) why = "needs at least two checkpoints";
+    if (why) {
+        munmap(data, bytes);
+        return trackError(path, why);
+    }
+    releaseTrack();
+    mapping = data;
+    mappedBytes = bytes;
+    setTrackArrays(header->start, arrays, header->counts);
+    return true;
+}
+bool saveTrack(const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return trackError(path, "cannot create");
+    const float *data[TRACK_SECTIONS];
+    TrackFileHeader header = {};
+    memcpy(header.magic, TRACK_MAGIC, 4);
+    header.version = TRACK_VERSION;
+    memcpy(header.start, trackStart, sizeof(header.start));
+    getTrackArrays(data, header.counts);
+    uint64_t offset = sizeof(header);
+    for (int s = 0; s < TRACK_SECTIONS; ++s) {
+        header.offsets[s] = offset;
+        offset += (uint64_t)header.counts[s] * sections[s].floats * sizeof(float);
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    for (int s = 0; s < TRACK_SECTIONS; ++s) fwrite(data[s], sizeof(float) * sections[s].floats, header.counts[s], file);
+    return fclose(file) == 0;
+}
+
+/*\ ---- Text form ---- \*/
+// One item per line: a keyword from sections[] (or "version"/"start") and its
+// numbers, in any order within the file; # starts a comment
+static bool parseTrack(const char *path, FILE *file) {
+    TrackBuilder track;
+    memcpy(track.start, trackStart, sizeof(track.start));
+    char line[1024];
+    int lineNumber = 0;
+    bool versioned = false;
+    while (fgets(line, sizeof(line), file)) {
+        ++lineNumber;
+        char *cursor = line;
+        while (*cursor == ' ' || *cursor == '\t') ++cursor;
+        if (*cursor == '#' || *cursor == '\n' || *cursor == '\r' || *cursor == 0) continue;
+        char *keywordEnd = cursor + strcspn(cursor, " \t\r\n");
+        std::string keyword(cursor, keywordEnd);
+        cursor = keywordEnd;
+
+        float numbers[16];
+        int count = 0;
+        for (char *end; count < 16; cursor = end) {
+            numbers[count] = strtof(cursor, &end);
+            if (end == cursor) break;
+            ++count;
+        }
+        while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n') ++cursor;
+
+        int expected = -1;
+        std::vector<float> *target = nullptr;
+        if (keyword == "version") {
+            expected = 1;
+            versioned = count == 1 && numbers[0] == TRACK_VERSION;
+            if (count == 1 && !versioned) return trackError(path, "unsupported version");
+        } else if (keyword == "start") {
+            expected = 3;
+            if (count == 3) memcpy(track.start, numbers, sizeof(track.start));
+        } else {
+            for (int s = 0; s < TRACK_SECTIONS; ++s) {
+                if (keyword == sections[s].keyword) {
+                    expected = sections[s].floats;
+                    target = &track.items[s];
+                }
+            }
+        }
+        if (expected < 0 || count != expected || (*cursor && *cursor != '#')) {
+            std::cerr << "Track " << path << ":" << lineNumber << ": expected "
+                      << (expected < 0 ? "a known keyword" : std::to_string(expected) + " numbers after " + keyword) << std::endl;
+            return false;
+        }
+        if (target) target->insert(target->end(), numbers, numbers + count);
+    }
+    if (!versioned) return trackError(path, "missing version line");
+    if (track.items[TRACK_CHECKPOINTS].size() < 2 * 4) return trackError(path, "needs at least two checkpoints");
+    return setTrack(track);
+}
+// Shortest decimal that reads back as the same float
+static void printFloat(FILE *file, float value) {
+    char text[32];
+    for (int digits = 6; digits <= 9; ++digits) {
+        snprintf(text, sizeof(text), "%.*g", digits, value);
+        if (strtof(text, nullptr) == value) break;
+    }
+    fprintf(file, " %s", text);
+}
+bool saveTrackText(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) return trackError(path, "cannot create");
+    const float *data[TRACK_SECTIONS];
+    uint32_t counts[TRACK_SECTIONS];
+    getTrackArrays(data, counts);
+    fprintf(file, "# Racing track. Angles are in radians, start heading in degrees.\n");
+    fprintf(file, "version %d\nstart", TRACK_VERSION);
+    for (float value : trackStart) printFloat(file, value);
+    fprintf(file, "\n");
+    for (int s = 0; s < TRACK_SECTIONS; ++s) {
+        for (uint32_t i = 0; i < counts[s]; ++i) {
+            fprintf(file, "%s", sections[s].keyword);
+            for (int f = 0; f < sections[s].floats; ++f) printFloat(file, data[s][i * sections[s].floats + f]);
+            fprintf(file, "\n");
+        }
+    }
+    return fclose(file) == 0;
+}
+
+bool loadTrack(const char *path) {
+    int file = open(path, O_RDONLY);
+    if (file < 0) return trackError(path, "cannot open");
+    char magic[4] = {};
+    bool binary = read(file, magic, 4) == 4 && memcmp(magic, TRACK_MAGIC, 4) == 0;
+    bool ok;
+    if (binary) {
+        ok = mapTrack(path, file);
+        close(file); // The mapping keeps the file open
+    } else {
+        close(file);
+        FILE *text = fopen(path, "r");
+        ok = text && parseTrack(path, text);
+        if (text) fclose(text);
+    }
+    return ok;
+}
@@ -0,0 +1,74 @@
+/******************************************
+*
+* Track geometry shared by the simulation and the renderer, loaded from a
+* track file. The binary form is memory-mapped and used in place, so
+* loading takes the same time however many segments the track has; the
+* text form is the editable source and is parsed line by line.
+* No GL/GLUT dependencies.
+*
+*******************************************/
+
+#ifndef TRACK_H
+#define TRACK_H
+
+#include <vector>
+
+#ifndef PI
+#define PI 3.14159
+#endif
+
+#define DEFAULT_TRACK_PATH "tracks/default.track"
+
+// Along-axis barriers: two opposite box corners {x1, y1, z1, x2, y2, z2}
+extern int axisBarriersCount;
+extern float (*axisBarriers)[6];
+
+// Curved barriers: {cx, cy, cz, outerRadius, innerRadius, startAngle, endAngle}
+extern int curveBarriersCount;
+extern float (*curveBarriers)[7];
+
+// Straight track floor quads: four corners and a normal
+extern int trackQuadsCount;
+extern float (*trackQuads)[5][3];
+
+// Curved track floor: {cx, cy, cz, radius1, radius2, startAngle, endAngle}
+extern int trackCurvesCount;
+extern float (*trackCurves)[7];
+
+// Trees beside the track: {x, y, z, trunkHeight, treeHeight}
+extern int trackTreesCount;
+extern float (*trackTrees)[5];
+
+// Checkpoints in lap order, each an open box {minX, minZ, maxX, maxZ} (bounds
+// may be infinite). Reaching the first starts the lap, the last completes it.
+extern int checkpointsCount;
+extern float (*checkpoints)[4];
+
+// Where resetSimulation() puts the car: {x, z, heading in degrees}
+extern float trackStart[3];
+
+// Sections of a track, in file order
+enum TrackSection {
+    TRACK_BARRIERS, TRACK_ARC_BARRIERS, TRACK_FLOORS, TRACK_ARC_FLOORS, TRACK_TREES, TRACK_CHECKPOINTS, TRACK_SECTIONS
+};
+
+// A track assembled in memory: each section's floats, a row of its array per item
+struct TrackBuilder {
+    float start[3] = {0, 0, 0};
+    std::vector<float> items[TRACK_SECTIONS];
+};
+
+// Make a built track the current one, moving its floats into the track's storage
+bool setTrack(TrackBuilder &track);
+
+// Load a track file in either form, replacing the current track. On failure
+// prints why and keeps the current track. The arrays above point into the
+// file's mapping (binary) or parsed copy (text) until the next load; call
+// rebuildTrackCollision() after loading if collision was already used.
+bool loadTrack(const char *path);
+
+// Write the current track as binary or text
+bool saveTrack(const char *path);
+bool saveTrackText(const char *path);
+
+#endif
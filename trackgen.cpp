@@ -0,0 +1,62 @@
+/******************************************
+*
+* Procedural track generator.
+*
+*******************************************/
+
+#include <cmath>
+#include <algorithm>
+#include <initializer_list>
+
+#include "trackgen.h"
+
+// Piece dimensions, as on the default track
+static const float pieceLength = 80;  // Along a straight
+static const float halfWidth = 40;    // Floor either side of the centre line
+static const float wallWidth = 5, wallHeight = 2.5f;
+static const float rowPitch = 120;    // Between row centre lines; a U-turn's centre line radius is half of it
+
+static void add(TrackBuilder &track, TrackSection section, std::initializer_list<float> floats) {
+    track.items[section].insert(track.items[section].end(), floats);
+}
+
+void generateTrack(TrackBuilder &track, int pieces) {
+    track = TrackBuilder();
+    pieces = std::max(pieces, 2);
+    // Rows of perRow straights, about as wide as the rows are tall
+    int perRow = std::max(2, (int)std::lround(std::sqrt(pieces * rowPitch / pieceLength)));
+
+    float x = 0, z = 0;
+    int direction = 1;  // +1 along +x, -1 along -x
+    add(track, TRACK_BARRIERS, {-wallWidth, 0, -halfWidth, 0, wallHeight, halfWidth}); // Start wall
+    for (int placed = 0, inRow = 0; placed < pieces; ++placed) {
+        if (inRow == perRow && placed + 1 < pieces) { // U-turn into the next row, never as the last piece
+            float cz = z + rowPitch / 2;
+            float outer = rowPitch / 2 + halfWidth, inner = rowPitch / 2 - halfWidth;
+            float startAngle = direction > 0 ? 3 * PI / 2 : PI / 2, endAngle = startAngle + PI;
+            add(track, TRACK_ARC_FLOORS, {x, 0, cz, outer, inner, startAngle, endAngle});
+            add(track, TRACK_ARC_BARRIERS, {x, wallHeight, cz, outer, outer - wallWidth, startAngle, endAngle});
+            add(track, TRACK_ARC_BARRIERS, {x, wallHeight, cz, inner + wallWidth, inner, startAngle, endAngle});
+            z += rowPitch;
+            direction = -direction;
+            inRow = 0;
+            continue;
+        }
+        float nextX = x + direction * pieceLength;
+        float maxX = std::max(x, nextX), minX = std::min(x, nextX);
+        add(track, TRACK_FLOORS, {maxX, 0, z - halfWidth, maxX, 0, z + halfWidth, minX, 0, z + halfWidth, minX, 0, z - halfWidth, 0, 1, 0});
+        add(track, TRACK_BARRIERS, {maxX, 0, z + halfWidth - wallWidth, minX, wallHeight, z + halfWidth});
+        add(track, TRACK_BARRIERS, {maxX, 0, z - halfWidth, minX, wallHeight, z - halfWidth + wallWidth});
+        x = nextX;
+        ++inRow;
+    }
+    add(track, TRACK_BARRIERS, {x, 0, z - halfWidth, x + direction * wallWidth, wallHeight, z + halfWidth}); // Finish wall
+
+    // Start just inside the first row facing along it; the finish is the end of the last row
+    track.start[0] = pieceLength / 4;
+    track.start[1] = 0;
+    track.start[2] = 90;
+    add(track, TRACK_CHECKPOINTS, {pieceLength / 2, -rowPitch / 2, INFINITY, rowPitch / 2});
+    if (direction > 0) add(track, TRACK_CHECKPOINTS, {x - pieceLength / 2, z - rowPitch / 2, INFINITY, z + rowPitch / 2});
+    else add(track, TRACK_CHECKPOINTS, {-INFINITY, z - rowPitch / 2, x + pieceLength / 2, z + rowPitch / 2});
+}
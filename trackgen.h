@@ -0,0 +1,22 @@
+/******************************************
+*
+* Procedural track generator for scaling tests. Lays out a serpentine of
+* straight rows joined by U-turns, built from the same pieces as the
+* default track: straight floor quads between along-axis barriers, and
+* curved floor between curved barriers. The area grows in proportion to
+* the piece count, from dozens to hundreds of thousands of pieces.
+* No GL/GLUT dependencies.
+*
+*******************************************/
+
+#ifndef TRACKGEN_H
+#define TRACKGEN_H
+
+#include "track.h"
+
+// Fill track with pieces floor pieces (at least 2): rows of straights about as
+// wide as the rows are tall, a start and finish checkpoint, and a wall across
+// each end. Use setTrack() to race or measure it.
+void generateTrack(TrackBuilder &track, int pieces);
+
+#endif